@@ -29,6 +29,7 @@
 
 #include <stdint.h>
 
+#include <avr/io.h>
 #include <avr/pgmspace.h>
 
 /*****************************************************************************/
@@ -37,8 +38,63 @@
 #  define CTASKFUNC(A) void A(void) CTASK;\
     void A(void)
 
+#ifdef AVRX_FASTINT
+#  define BeginCritical() asm volatile ("%~call _AvrXMask\n" ::: "memory")
+#  define EndCritical()   asm volatile ("%~call _AvrXUnmask\n\tsei\n" ::: "memory")
+#else
 #  define BeginCritical() asm volatile ("cli\n")
 #  define EndCritical()   asm volatile ("sei\n")
+#endif
+
+/*
+    Nestable critical sections.  AvrXEnterCritical() disables interrupts
+    and returns the previous SREG for AvrXLeaveCritical() to put back, so
+    a section inside another (or in an interrupt handler) does not turn
+    interrupts on early:
+
+        uint8_t s = AvrXEnterCritical();
+        ...
+        AvrXLeaveCritical(s);
+
+    To keep other tasks out while leaving interrupts on, use
+    AvrXSchedLock() instead.
+
+    With AVRX_FASTINT these, and BeginCritical()/EndCritical(), only turn
+    off the kernel's interrupt sources; see avrx_fastint.S.  Data shared
+    with a fast interrupt handler still needs cli().
+*/
+#ifdef AVRX_FASTINT
+static inline uint8_t AvrXEnterCritical(void)
+{
+    uint8_t sreg;
+    asm volatile ("in %0, __SREG__\n\t"
+                  "%~call _AvrXMask\n\t"
+                  "bld %0, 6\n"            /* T = sources were on */
+                  : "=r" (sreg) :: "memory");
+    return sreg;
+}
+
+static inline void AvrXLeaveCritical(uint8_t sreg)
+{
+    asm volatile ("sbrc %0, 6\n\t"
+                  "%~call _AvrXUnmask\n\t"
+                  "out __SREG__, %0\n"
+                  :: "r" (sreg) : "memory");
+}
+#else
+static inline uint8_t AvrXEnterCritical(void)
+{
+    uint8_t sreg = SREG;
+    asm volatile ("cli\n" ::: "memory");
+    return sreg;
+}
+
+static inline void AvrXLeaveCritical(uint8_t sreg)
+{
+    asm volatile ("" ::: "memory");
+    SREG = sreg;
+}
+#endif
 
 /*****************************************************************************/
 /*****************************************************************************/
@@ -78,7 +134,20 @@ typedef struct ProcessID
 #define AVRX_PID_Suspended    (_BV(6))       /* Mark task suspended (it was removed from the run queue) */
 
     uint8_t            priority;
+#ifdef AVRX_DLIST
+    void              *prev;        /* Previous PID or queue head */
+#endif
     void              *ContextPointer;
+#ifdef AVRX_TIMESLICE
+    uint8_t            quantum;     /* Ticks per time slice, 0 = cooperative */
+    uint8_t            slice;       /* Ticks left in the current slice */
+#endif
+#ifdef AVRX_EDF
+    uint16_t           deadline;    /* Absolute deadline of the current job */
+    uint16_t           period;      /* Release period in ticks, 0 = not EDF */
+    uint16_t           reldeadline; /* Deadline relative to each release */
+    uint8_t            misses;      /* Deadlines missed (saturates at 255) */
+#endif
 }
 * pProcessID, ProcessID;
 
@@ -90,6 +159,8 @@ struct AvrXKernelData
     struct ProcessID *Running;
     void             *AvrXStack;
     uint8_t           SysLevel;
+    uint8_t           SchedLock;
+    uint8_t           Restoring;
 };
 
 /*****************************************************************************/
@@ -143,6 +214,150 @@ extern Mutex AvrXTestSemaphore(pMutex);
  *****************************************************************************/
 extern void AvrXResetSemaphore(pMutex);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXBroadcastSemaphore
+ *      AvrXIntBroadcastSemaphore
+ *
+ *  SYNOPSIS
+ *      void AvrXBroadcastSemaphore(pMutex)
+ *      void AvrXIntBroadcastSemaphore(pMutex)
+ *
+ *  DESCRIPTION
+ *      Releases every task waiting on the semaphore in one critical
+ *      section, and (AvrXBroadcastSemaphore from a task) reschedules once
+ *      afterwards.  The semaphore is left _PEND.  Unlike a set, a
+ *      broadcast with nobody waiting has no effect.
+ *      The Int version is safe to be called from within an interrupt handler.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXBroadcastSemaphore(pMutex);
+extern void AvrXIntBroadcastSemaphore(pMutex);
+
+/*
+    A barrier holds back a group of 'ntasks' tasks until all of them
+    have reached it, then releases them together.
+*/
+typedef struct Barrier
+{
+    Mutex   sem;            /* Tasks waiting for the rest */
+    uint8_t count;          /* Tasks arrived this round */
+    uint8_t ntasks;         /* Tasks in the group */
+}
+* pBarrier, Barrier;
+
+#define AVRX_BARRIER(A, ntasks) \
+        Barrier A = { AVRX_SEM_PEND, 0, ntasks }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXBarrierWait
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXBarrierWait(pBarrier pBar)
+ *
+ *  DESCRIPTION
+ *      Blocks until all 'ntasks' tasks of the group have called
+ *      AvrXBarrierWait, then releases them all with a single broadcast.
+ *      The barrier is then ready for the next round.  Task context only.
+ *
+ *  RETURNS
+ *      1 in the last task to arrive (the one that released the others),
+ *      0 in the rest
+ *
+ *****************************************************************************/
+extern uint8_t AvrXBarrierWait(pBarrier);
+
+/*
+    A sequence lock carries the latest value of some data (a sensor
+    reading, say) from one writer to any number of reader tasks.  The
+    writer never blocks and never waits for the readers; a reader that
+    was overtaken by a write copies again.  The sequence is odd while a
+    write is in progress and goes up by two with each write.
+
+    The data itself lives wherever the user likes; the lock only guards
+    it.  There must be only one writer at a time: either one interrupt
+    handler, or tasks using the task version.  Readers must be tasks.
+*/
+typedef struct SeqLock
+{
+    Mutex   sem;            /* Readers waiting for the next write */
+    volatile uint8_t seq;   /* Odd while a write is in progress */
+}
+* pSeqLock, SeqLock;
+
+#define AVRX_SEQLOCK(A) \
+        SeqLock A = { AVRX_SEM_PEND, 0 }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSeqWrite
+ *      AvrXIntSeqWrite
+ *
+ *  SYNOPSIS
+ *      void AvrXSeqWrite(pSeqLock pLock, void *data,
+ *                        const void *value, uint8_t size)
+ *      void AvrXIntSeqWrite(pSeqLock pLock, void *data,
+ *                           const void *value, uint8_t size)
+ *
+ *  DESCRIPTION
+ *      Copies 'size' bytes from 'value' into the guarded 'data', then
+ *      wakes every task waiting in AvrXSeqWait.  Interrupts stay enabled
+ *      during the copy.  The task version holds the scheduler lock over
+ *      the copy so that no reader can preempt a half done write.  The
+ *      Int version is for the interrupt handler that is the writer.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSeqWrite(pSeqLock, void *, const void *, uint8_t);
+extern void AvrXIntSeqWrite(pSeqLock, void *, const void *, uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSeqRead
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXSeqRead(pSeqLock pLock, void *value,
+ *                          const void *data, uint8_t size)
+ *
+ *  DESCRIPTION
+ *      Copies 'size' bytes of the guarded 'data' into 'value', again
+ *      until no write overlapped the copy.  Task context only.
+ *
+ *  RETURNS
+ *      The sequence of the copy, for AvrXSeqWait
+ *
+ *****************************************************************************/
+extern uint8_t AvrXSeqRead(pSeqLock, void *, const void *, uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSeqWait
+ *
+ *  SYNOPSIS
+ *      void AvrXSeqWait(pSeqLock pLock, uint8_t seq)
+ *
+ *  DESCRIPTION
+ *      Blocks until the data has been written since AvrXSeqRead returned
+ *      'seq'.  Returns at once if it already has.  A reader that misses
+ *      exactly 128 writes waits for one more.  Task context only.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSeqWait(pSeqLock, uint8_t);
+
 /*****************************************************************************/
 /*****************************************************************************/
 /***                                                                       ***/
@@ -155,6 +370,9 @@ typedef struct SystemObject
 {
     struct SystemObject *next;
     Mutex semaphore;    
+#ifdef AVRX_DLIST
+    void *prev;         /* Previous object or queue head */
+#endif
 }
 * pSystemObject, SystemObject;
 
@@ -235,6 +453,85 @@ extern Mutex AvrXTestObjectSemaphore(pSystemObject);
  *****************************************************************************/
 extern void AvrXWaitObjectSemaphore(pSystemObject);
 
+/*
+    Inline fast paths.  Unless AVRX_NO_INLINE is defined the semaphore
+    calls above are expanded in place for the cases that need no task
+    switch: a wait on a _DONE semaphore, a set with nobody waiting, and
+    every test and reset.  Otherwise they drop into the kernel as before.
+    The library functions are still there for assembly code and function
+    pointers.  Waits stay out of line with AVRX_STATS, which counts them.
+*/
+#ifndef AVRX_NO_INLINE
+
+static inline void _AvrXSetSemaphore(pMutex p, void (*kernel)(pMutex))
+{
+    uint8_t sreg = AvrXEnterCritical();
+    if ((uintptr_t)*p <= (uintptr_t)AVRX_SEM_DONE)
+    {
+        *p = AVRX_SEM_DONE;         // Nobody waiting
+        AvrXLeaveCritical(sreg);
+        return;
+    }
+    AvrXLeaveCritical(sreg);
+    kernel(p);
+}
+
+static inline Mutex _AvrXTestSemaphore(pMutex p)
+{
+    uint8_t sreg = AvrXEnterCritical();
+    Mutex m = *p;
+
+    if (m == AVRX_SEM_DONE)
+        *p = AVRX_SEM_PEND;
+    else if (m != AVRX_SEM_PEND)
+        m = AVRX_SEM_WAIT;
+    AvrXLeaveCritical(sreg);
+    return m;
+}
+
+static inline void _AvrXResetSemaphore(pMutex p)
+{
+    uint8_t sreg = AvrXEnterCritical();
+    if (*p == AVRX_SEM_DONE)
+        *p = AVRX_SEM_PEND;
+    AvrXLeaveCritical(sreg);
+}
+
+#  define AvrXSetSemaphore(A)     _AvrXSetSemaphore(A, AvrXSetSemaphore)
+#  define AvrXIntSetSemaphore(A)  _AvrXSetSemaphore(A, AvrXIntSetSemaphore)
+#  define AvrXTestSemaphore(A)    _AvrXTestSemaphore(A)
+#  define AvrXResetSemaphore(A)   _AvrXResetSemaphore(A)
+
+#  define AvrXSetObjectSemaphore(A) \
+            AvrXSetSemaphore(&((pSystemObject)(A))->semaphore)
+#  define AvrXIntSetObjectSemaphore(A) \
+            AvrXIntSetSemaphore(&((pSystemObject)(A))->semaphore)
+#  define AvrXTestObjectSemaphore(A) \
+            AvrXTestSemaphore(&((pSystemObject)(A))->semaphore)
+#  define AvrXResetObjectSemaphore(A) \
+            AvrXResetSemaphore(&((pSystemObject)(A))->semaphore)
+
+#  ifndef AVRX_STATS
+static inline void _AvrXWaitSemaphore(pMutex p)
+{
+    uint8_t sreg = AvrXEnterCritical();
+    if (*p == AVRX_SEM_DONE)
+    {
+        *p = AVRX_SEM_PEND;         // Uncontended, carry on
+        AvrXLeaveCritical(sreg);
+        return;
+    }
+    AvrXLeaveCritical(sreg);
+    AvrXWaitSemaphore(p);
+}
+
+#    define AvrXWaitSemaphore(A)       _AvrXWaitSemaphore(A)
+#    define AvrXWaitObjectSemaphore(A) \
+            AvrXWaitSemaphore(&((pSystemObject)(A))->semaphore)
+#  endif
+
+#endif /* AVRX_NO_INLINE */
+
 /*****************************************************************************/
 /*****************************************************************************/
 /***                                                                       ***/
@@ -288,6 +585,54 @@ extern void AvrXIntSendMessage(pMessageQueue, pMessageControlBlock);
 #define AvrXTestMessageAck(A) \
         AvrXTestObjectSemaphore((pSystemObject)(A))
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXCall
+ *
+ *  SYNOPSIS
+ *      void AvrXCall(pMessageQueue pQueue, pMessageControlBlock pMsg)
+ *
+ *  DESCRIPTION
+ *      Sends 'pMsg' to 'pQueue' and blocks until it is acknowledged.  The
+ *      same as AvrXSendMessage() then AvrXWaitMessageAck(), but done in
+ *      one kernel entry: the caller goes straight from running to waiting
+ *      for the ack, and a server waiting on the queue runs next without
+ *      the caller being put back on the run queue.  Task context only.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXCall(pMessageQueue, pMessageControlBlock);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXReplyAndWait
+ *
+ *  SYNOPSIS
+ *      pMessageControlBlock AvrXReplyAndWait(pMessageQueue pQueue,
+ *                                            pMessageControlBlock pReply)
+ *
+ *  DESCRIPTION
+ *      Server side of AvrXCall().  Acknowledges 'pReply' (if not NULL) and
+ *      waits for the next message on 'pQueue', in one kernel entry when
+ *      the queue is empty.  A server loop is then:
+ *
+ *          pMessageControlBlock m = NOMESSAGE;
+ *          while (1)
+ *          {
+ *              m = AvrXReplyAndWait(&Server, m);
+ *              ... handle m ...
+ *          }
+ *
+ *  RETURNS
+ *      The next message
+ *
+ *****************************************************************************/
+extern pMessageControlBlock AvrXReplyAndWait(pMessageQueue, pMessageControlBlock);
+
 /*****************************************************************************/
 /*****************************************************************************/
 /***                                                                       ***/
@@ -330,6 +675,29 @@ typedef struct TimerControlBlock
  
 extern void AvrXStartTimer(pTimerControlBlock, uint16_t);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXStartTimerSlack
+ *
+ *  SYNOPSIS
+ *      void AvrXStartTimerSlack(pTimerControlBlock pTCB, uint16_t count,
+ *                               uint16_t slack)
+ *
+ *  DESCRIPTION
+ *      Start a timer pTCB to run for count system ticks, allowing it to
+ *      expire up to 'slack' ticks late so that it can share a tick with
+ *      another timer.  Timers that expire together cost one wake-up, so
+ *      generous slack on timers that don't need to be punctual (LEDs,
+ *      telemetry, watchdog kicks) means fewer ticks in which tasks run.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+ 
+extern void AvrXStartTimerSlack(pTimerControlBlock, uint16_t, uint16_t);
+
 /*****************************************************************************
  *
  *  FUNCTION
@@ -348,6 +716,43 @@ extern void AvrXStartTimer(pTimerControlBlock, uint16_t);
  
 extern pTimerControlBlock AvrXCancelTimer(pTimerControlBlock);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXIntStartTimer
+ *      AvrXIntCancelTimer
+ *
+ *  SYNOPSIS
+ *      void AvrXIntStartTimer(pTimerControlBlock pTCB, uint16_t count)
+ *      pTimerControlBlock AvrXIntCancelTimer(pTimerControlBlock pTCB)
+ *
+ *  DESCRIPTION
+ *      Versions of AvrXStartTimer() and AvrXCancelTimer() for use inside
+ *      an AvrXEnterKernel()/AvrXLeaveKernel() section, e.g. to arm and
+ *      cancel a receive timeout from a UART interrupt.  A timer may be
+ *      restarted by cancelling it and starting it again.
+ *
+ *      If the interrupt has broken into code that is walking the timer
+ *      queue (AvrXStartTimer() or the timer handler) the request is kept
+ *      and carried out, in order, before that code returns.  Up to
+ *      AVRX_TIMER_REQUESTS requests can be held; more is a fatal error
+ *      (AvrXHalt).
+ *
+ *  RETURNS
+ *      AvrXIntCancelTimer: pointer to the removed timer, or 0 if it was
+ *      not running or the cancel had to be kept.  A kept cancel still
+ *      takes effect, and sets the semaphore, before the timer handler or
+ *      AvrXStartTimer() returns.
+ *
+ *****************************************************************************/
+
+#ifndef AVRX_TIMER_REQUESTS
+#define AVRX_TIMER_REQUESTS 4
+#endif
+
+extern void AvrXIntStartTimer(pTimerControlBlock, uint16_t);
+extern pTimerControlBlock AvrXIntCancelTimer(pTimerControlBlock);
+
 /*****************************************************************************
  *
  *  FUNCTION
@@ -366,6 +771,25 @@ extern pTimerControlBlock AvrXCancelTimer(pTimerControlBlock);
  
 extern void AvrXDelay(pTimerControlBlock, uint16_t);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXDelaySlack
+ *
+ *  SYNOPSIS
+ *      void AvrXDelaySlack(pTimerControlBlock pTCB, uint16_t count,
+ *                          uint16_t slack)
+ *
+ *  DESCRIPTION
+ *      Utility function combining AvrXStartTimerSlack() and AvrXWaitTimer().
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+ 
+extern void AvrXDelaySlack(pTimerControlBlock, uint16_t, uint16_t);
+
 /*****************************************************************************
  *
  *  FUNCTION
@@ -460,8 +884,104 @@ typedef struct TimerMessageBlock
 // to a message queue when expired.
 
 extern void AvrXStartTimerMessage(pTimerMessageBlock, uint16_t, pMessageQueue);
+extern void AvrXIntStartTimerMessage(pTimerMessageBlock, uint16_t, pMessageQueue);
 extern pMessageControlBlock AvrXCancelTimerMessage(pTimerMessageBlock, pMessageQueue);
 
+#ifdef AVRX_STATS
+/*****************************************************************************/
+/*****************************************************************************/
+/***                                                                       ***/
+/***                         S T A T I S T I C S                           ***/
+/***                                                                       ***/
+/*****************************************************************************/
+/*****************************************************************************/
+/*
+    With AVRX_STATS the kernel keeps usage figures for any semaphore or
+    message queue that has a statistics block registered for it.  Objects
+    without one cost a short search of the registered list on each wait,
+    send and receive.
+
+        AvrXStats BusStats, RxStats;
+
+        AvrXStatsMutex(&BusStats, &BusMutex);
+        AvrXStatsQueue(&RxStats, &RxQueue);
+        ...
+        for (p = AvrXStatsFirst(); p; p = p->next)
+            ... print p->acquires, p->contended ...
+
+    For a semaphore, 'acquires' counts calls to AvrXWaitSemaphore() and
+    'contended' those that had to block; 'maxwaiters' is the most tasks
+    seen queued on it at once.
+
+    For a message queue, 'acquires' counts messages received, 'contended'
+    receives that found the queue empty, 'maxwaiters' the most tasks seen
+    waiting for a message and 'maxdepth' the most messages seen queued.
+*/
+typedef struct AvrXStats
+{
+    struct AvrXStats *next;
+    void *object;           // Semaphore, or the queue's task semaphore
+    uint8_t kind;
+    uint8_t maxwaiters;
+    uint8_t maxdepth;       // Message queues only
+    uint16_t acquires;
+    uint16_t contended;
+}
+* pAvrXStats, AvrXStats;
+
+#define AVRX_STATS_MUTEX 0
+#define AVRX_STATS_QUEUE 1
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXStatsMutex
+ *      AvrXStatsQueue
+ *
+ *  SYNOPSIS
+ *      void AvrXStatsMutex(pAvrXStats pStats, pMutex pMutex)
+ *      void AvrXStatsQueue(pAvrXStats pStats, pMessageQueue pQueue)
+ *
+ *  DESCRIPTION
+ *      Clears statistics block 'pStats' and starts recording into it for
+ *      the given semaphore or message queue.  A block must only be
+ *      registered once.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXStatsRegister(pAvrXStats, void *, uint8_t);
+
+#define AvrXStatsMutex(A, B) \
+        AvrXStatsRegister((A), (B), AVRX_STATS_MUTEX)
+#define AvrXStatsQueue(A, B) \
+        AvrXStatsRegister((A), &(B)->pid, AVRX_STATS_QUEUE)
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXStatsFirst
+ *      AvrXStatsReset
+ *
+ *  SYNOPSIS
+ *      pAvrXStats AvrXStatsFirst(void)
+ *      void AvrXStatsReset(pAvrXStats pStats)
+ *
+ *  DESCRIPTION
+ *      AvrXStatsFirst() returns the most recently registered block; the
+ *      rest follow through the 'next' field.  AvrXStatsReset() clears the
+ *      figures of one block.  Copy a block with interrupts off if its
+ *      fields must agree with each other.
+ *
+ *  RETURNS
+ *      AvrXStatsFirst: first block, or 0 if none are registered
+ *
+ *****************************************************************************/
+extern pAvrXStats AvrXStatsFirst(void);
+extern void AvrXStatsReset(pAvrXStats);
+#endif
+
 /*****************************************************************************/
 /*****************************************************************************/
 /***                                                                       ***/
@@ -504,8 +1024,23 @@ TCB(start)
 */
 
 #define MINCONTEXT 35           // 32 registers, return address and SREG
+
+/*
+    _Epilog reloads a task's registers with interrupts enabled while the
+    saved context is still on the task stack, just above SP.  An interrupt
+    in that window stacks below the context: 9 bytes for a kernel interrupt
+    (vector return address, the call to AvrXEnterKernel and 5 registers),
+    14 with AVRX_FASTINT, or the whole prologue of a plain ISR().  The
+    task macros add AVRX_RESTORE_STACK to every stack for it; the default
+    covers an ISR() that saves a return address, SREG and the 14 call used
+    registers.  Define it larger for handlers that save more.
+*/
+#ifndef AVRX_RESTORE_STACK
+#  define AVRX_RESTORE_STACK 17
+#endif
+
 #define AVRX_TASK(start, c_stack, priority) \
-    uint8_t start ## Stk [c_stack + MINCONTEXT] ; \
+    uint8_t start ## Stk [c_stack + MINCONTEXT + AVRX_RESTORE_STACK] ; \
     CTASKFUNC(start); \
     ProcessID start ## Pid; \
     TaskControlBlock start ## Tcb = \
@@ -565,12 +1100,69 @@ extern pProcessID AvrXInitTask(TaskControlBlock *);
  *****************************************************************************/
 extern void AvrXRunTask(TaskControlBlock *);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXRunTasks
+ *
+ *  SYNOPSIS
+ *      void AvrXRunTasks(TaskControlBlock * const *table, uint8_t n)
+ *
+ *  DESCRIPTION
+ *      Starts the n tasks in a table of TCB pointers kept in flash, as
+ *      AvrXRunTask() on each but entering the kernel only once and
+ *      building the run queue in one pass.  Tasks of equal priority are
+ *      queued in table order.
+ *
+ *          TaskControlBlock * const Boot[] PROGMEM =
+ *              { TCB(monitor), TCB(uart), TCB(control) };
+ *
+ *          AvrXRunTasks(Boot, sizeof(Boot) / sizeof(Boot[0]));
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXRunTasks(TaskControlBlock * const *, uint8_t);
+
 
 extern void AvrXResume(pProcessID);
 extern void AvrXSuspend(pProcessID);
 extern void AvrXYield(void);
 extern void AvrXIntReschedule(void);
 
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSchedLock
+ *      AvrXSchedUnlock
+ *
+ *  SYNOPSIS
+ *      void AvrXSchedLock(void)
+ *      void AvrXSchedUnlock(void)
+ *
+ *  DESCRIPTION
+ *      Keeps the calling task running until the matching unlock, with
+ *      interrupts left enabled.  Interrupt handlers still run and can
+ *      make other tasks ready, but the switch to them is held back until
+ *      the last AvrXSchedUnlock().  Locks nest.
+ *
+ *      Use this in place of BeginCritical()/EndCritical() for longer
+ *      regions that only need to be safe from other tasks.  The locking
+ *      task must not block, yield to a lower priority or terminate while
+ *      it holds the lock.  Task context only.
+ *
+ *      An unlock inside AvrXEnterCritical()/AvrXLeaveCritical() leaves
+ *      interrupts as they are and does not switch; a task readied meanwhile
+ *      runs the next time an interrupt or kernel call leaves the kernel.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSchedLock(void);
+extern void AvrXSchedUnlock(void);
+
 /*****************************************************************************
  *
  *  FUNCTION
@@ -606,8 +1198,141 @@ extern void AvrXIntReschedule(void);
  *****************************************************************************/
 extern void AvrXTaskExit(void);
 
-/*****************************************************************************
- *
+/*****************************************************************************/
+/*
+    Task pools hold a fixed number of stack/PID slots that are handed out
+    at run time by AvrXSpawn().  A spawned task runs 'func(arg)'; when it
+    returns (or calls AvrXPoolExit) its completion semaphore is set and the
+    slot becomes free for the next spawn.
+
+AVRX_TASKPOOL(pool, nslots, c_stack)
+    Declare a pool of 'nslots' tasks each with 'c_stack' bytes of stack
+    over and above the saved context.
+*/
+typedef void (*AvrXPoolFunc)(void *);
+
+typedef struct PoolTask
+{
+    ProcessID pid;                  // Must be first, see AvrXPoolExit
+    Mutex     done;                 // Set when the task finishes
+}
+* pPoolTask, PoolTask;
+
+typedef struct TaskPool
+{
+    pPoolTask slots;
+    uint8_t  *stacks;
+    uint8_t   nslots;
+    uint16_t  stacksz;
+}
+* pTaskPool, TaskPool;
+
+#define AVRX_TASKPOOL(A, nslots, c_stack) \
+    uint8_t A ## Stk [nslots][c_stack + MINCONTEXT + AVRX_RESTORE_STACK + 2]; \
+    PoolTask A ## Slots [nslots]; \
+    TaskPool A = \
+    { \
+        A##Slots, \
+        &A##Stk[0][0], \
+        nslots, \
+        c_stack + MINCONTEXT + AVRX_RESTORE_STACK + 2 \
+    }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXPoolInit
+ *
+ *  SYNOPSIS
+ *      void AvrXPoolInit(pTaskPool pPool)
+ *
+ *  DESCRIPTION
+ *      Marks every slot in the pool free.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXPoolInit(pTaskPool);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSpawn
+ *
+ *  SYNOPSIS
+ *      pPoolTask AvrXSpawn(pTaskPool pPool, AvrXPoolFunc func, void *arg,
+ *                          uint8_t priority)
+ *
+ *  DESCRIPTION
+ *      Takes a free slot from the pool and runs 'func(arg)' in it at
+ *      'priority'.  Task context only.
+ *
+ *  RETURNS
+ *      Handle of the new task, or 0 if no slot is free
+ *
+ *****************************************************************************/
+extern pPoolTask AvrXSpawn(pTaskPool, AvrXPoolFunc, void *, uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXJoin
+ *
+ *  SYNOPSIS
+ *      void AvrXJoin(pPoolTask t)
+ *
+ *  DESCRIPTION
+ *      Blocks until task 't' has finished.  Only one task should join a
+ *      given spawn, and only before the slot is spawned again.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+#define AvrXJoin(A) \
+        AvrXWaitSemaphore(&(A)->done)
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXPoolExit
+ *
+ *  SYNOPSIS
+ *      void AvrXPoolExit(void)
+ *
+ *  DESCRIPTION
+ *      Called by a pool task to finish early.  Returning from the task
+ *      function does the same.
+ *
+ *  RETURNS
+ *      Never returns
+ *
+ *****************************************************************************/
+extern void AvrXPoolExit(void) __attribute__ ((noreturn));
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXPoolKill
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXPoolKill(pPoolTask t)
+ *
+ *  DESCRIPTION
+ *      Terminates pool task 't', freeing its slot, and then sets its
+ *      completion semaphore.  With AVRX_DLIST the task is unlinked from whatever
+ *      queue it is blocked on.  Without it a task blocked on a semaphore
+ *      or message queue cannot be unlinked and is left running.
+ *
+ *  RETURNS
+ *      1 if the task was killed, 0 if not
+ *
+ *****************************************************************************/
+extern uint8_t AvrXPoolKill(pPoolTask);
+
+/*****************************************************************************
+ *
  *  FUNCTION
  *      AvrXHalt
  *
@@ -644,18 +1369,139 @@ extern uint8_t AvrXPriority(pProcessID);
  *
  *  FUNCTION
  *      AvrXChangePriority
+ *      AvrXIntChangePriority
  *
  *  SYNOPSIS
  *      uint8_t AvrXChangePriority(pProcessID p, uint8_t priority)
+ *      uint8_t AvrXIntChangePriority(pProcessID p, uint8_t priority)
  *
  *  DESCRIPTION
- *      Changes the priority of process 'p' to 'priority'.
+ *      Changes the priority of process 'p' to 'priority'.  If 'p' is on
+ *      the run queue it is re-inserted at its new position, and if that
+ *      changes the top of the run queue the new top runs immediately
+ *      (AvrXChangePriority) or on exit from the interrupt handler
+ *      (AvrXIntChangePriority).  A blocked process simply takes its new
+ *      priority when it is next queued.
+ *      The Int version is safe to be called from within an interrupt handler.
  *
  *  RETURNS
  *      The previous priority
  *
  *****************************************************************************/
 extern uint8_t AvrXChangePriority(pProcessID, uint8_t);
+extern uint8_t AvrXIntChangePriority(pProcessID, uint8_t);
+
+#ifdef AVRX_TIMESLICE
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSetTimeSlice
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXSetTimeSlice(pProcessID p, uint8_t quantum)
+ *
+ *  DESCRIPTION
+ *      Sets the time slice of process 'p' to 'quantum' system ticks.  When
+ *      the slice runs out, AvrXTimerHandler() moves the process behind any
+ *      other ready processes of the same priority.  A quantum of 0 (the
+ *      default) leaves the process cooperatively scheduled.
+ *
+ *      A process is only charged for ticks in which it was running, and
+ *      gets a full slice again each time it is put on the run queue.
+ *
+ *  RETURNS
+ *      The previous quantum
+ *
+ *****************************************************************************/
+extern uint8_t AvrXSetTimeSlice(pProcessID, uint8_t);
+#endif
+
+#ifdef AVRX_EDF
+/*
+    Earliest deadline first scheduling.  Periodic tasks that share a
+    priority and have been given a period with AvrXEdfSetPeriod() are run
+    in order of their absolute deadlines rather than round robin.  They
+    still sit in the normal priority order, so more urgent (lower number)
+    priorities preempt them and less urgent ones only run when none of
+    them is ready.  Deadlines are counted in AvrXTimerHandler() ticks.
+
+        AVRX_TASKDEF(fusion, 40, 5)
+        {
+            AvrXEdfSetPeriod(AvrXSelf(), 20, 15);
+            while (1)
+            {
+                ... one job ...
+                AvrXEdfWaitPeriod(&FusionTimer);
+            }
+        }
+
+    Do not give EDF tasks a time slice (AVRX_TIMESLICE): slicing rotates
+    equal priority tasks regardless of their deadlines.
+*/
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEdfSetPeriod
+ *
+ *  SYNOPSIS
+ *      void AvrXEdfSetPeriod(pProcessID p, uint16_t period, uint16_t deadline)
+ *
+ *  DESCRIPTION
+ *      Makes process 'p' a periodic EDF task released every 'period'
+ *      ticks, each job due 'deadline' ticks after its release.  The first
+ *      job is released now.  A period of 0 makes 'p' an ordinary task
+ *      again.  Also clears the deadline miss counter.  AvrXRunTask()
+ *      clears the period, so call this after starting the task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEdfSetPeriod(pProcessID, uint16_t, uint16_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEdfWaitPeriod
+ *
+ *  SYNOPSIS
+ *      void AvrXEdfWaitPeriod(pTimerControlBlock pTCB)
+ *
+ *  DESCRIPTION
+ *      Ends the current job of the calling EDF task, counts a miss if its
+ *      deadline has passed, and waits on timer 'pTCB' for the next
+ *      release.  If the next release has already passed the next job
+ *      starts at once.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEdfWaitPeriod(pTimerControlBlock);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEdfNow
+ *      AvrXEdfMisses
+ *
+ *  SYNOPSIS
+ *      uint16_t AvrXEdfNow(void)
+ *      uint8_t AvrXEdfMisses(pProcessID p)
+ *
+ *  DESCRIPTION
+ *      The current tick count used for deadlines, and the number of
+ *      deadlines process 'p' has missed since AvrXEdfSetPeriod().
+ *
+ *  RETURNS
+ *      As above
+ *
+ *****************************************************************************/
+extern uint16_t AvrXEdfNow(void);
+
+#define AvrXEdfMisses(p) ((p)->misses)
+#endif
 
 /*****************************************************************************
  *
@@ -705,6 +1551,353 @@ extern pProcessID AvrXSelf(void);
 extern void AvrXEnterKernel(void);
 extern void AvrXLeaveKernel(void);
 
+#ifdef AVRX_POWER
+/*****************************************************************************/
+/*****************************************************************************/
+/***                                                                       ***/
+/***                   P O W E R   M A N A G E M E N T                     ***/
+/***                                                                       ***/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+    With AVRX_POWER the kernel's idle loop picks a sleep mode each time it
+    runs out of tasks.  Modes are numbered from the lightest (CPU only) to
+    the deepest.  A driver whose peripheral must keep running holds the
+    deepest mode it can live with, and the idle loop sleeps no deeper than
+    the lightest mode held:
+
+        AvrXPowerHold(AVRX_SLEEP_IDLE);         // UART clocks needed
+        ...
+        AvrXPowerRelease(AVRX_SLEEP_IDLE);
+
+    While a timer is running the system tick must keep going, so the mode
+    is also limited to AVRX_TICK_SLEEP (the deepest mode the tick source
+    runs in, AVRX_SLEEP_IDLE unless defined otherwise), and to
+    AVRX_SLEEP_IDLE if the next timer expires within AVRX_SLEEP_MINTICKS
+    ticks.  With no timers running and nothing held the deepest mode is
+    used, and only an external interrupt wakes the system.
+
+    An idle hook runs before each sleep, with interrupts on and on the
+    kernel stack.  It has no context of its own: any interrupt handler
+    that uses the kernel abandons it, and it is started again from the top
+    the next time the system is idle.  It must not call AvrX functions that
+    block, and anything it must not leave half done needs a critical
+    section.
+
+    AvrXPowerStats counts the entries into each mode and the system ticks
+    that found the system idle in each, for modes the tick runs in.
+*/
+#define AVRX_SLEEP_IDLE     0       /* CPU stopped, everything else runs */
+#define AVRX_SLEEP_ADC      1       /* ADC noise reduction */
+#define AVRX_SLEEP_PWR_SAVE 2       /* Only the asynchronous timer runs */
+#define AVRX_SLEEP_PWR_DOWN 3       /* External interrupts only */
+#define AVRX_SLEEP_MODES    4
+
+#ifndef AVRX_TICK_SLEEP
+#  define AVRX_TICK_SLEEP AVRX_SLEEP_IDLE
+#endif
+#ifndef AVRX_SLEEP_MINTICKS
+#  define AVRX_SLEEP_MINTICKS 2
+#endif
+
+typedef struct AvrXPower
+{
+    uint16_t entries[AVRX_SLEEP_MODES];     /* Times each mode was entered */
+    uint16_t ticks[AVRX_SLEEP_MODES];       /* Idle ticks spent in each */
+}
+* pAvrXPower, AvrXPower;
+
+extern AvrXPower AvrXPowerStats;
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXPowerHold
+ *      AvrXPowerRelease
+ *
+ *  SYNOPSIS
+ *      void AvrXPowerHold(uint8_t mode)
+ *      void AvrXPowerRelease(uint8_t mode)
+ *
+ *  DESCRIPTION
+ *      Keep the idle loop from sleeping deeper than 'mode', and undo it.
+ *      Holds are counted, so each hold needs its own release.  Callable
+ *      from tasks and interrupt handlers.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXPowerHold(uint8_t);
+extern void AvrXPowerRelease(uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSetIdleHook
+ *
+ *  SYNOPSIS
+ *      void AvrXSetIdleHook(void (*hook)(void))
+ *
+ *  DESCRIPTION
+ *      Sets the function run by the idle loop before each sleep, or none
+ *      if 'hook' is NULL.  See above for what it may do.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSetIdleHook(void (*)(void));
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXPowerReset
+ *
+ *  SYNOPSIS
+ *      void AvrXPowerReset(void)
+ *
+ *  DESCRIPTION
+ *      Clears AvrXPowerStats.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXPowerReset(void);
+#endif /* AVRX_POWER */
+
+#ifdef AVRX_GOVERNOR
+/*****************************************************************************/
+/*****************************************************************************/
+/***                                                                       ***/
+/***                     C L O C K   G O V E R N O R                       ***/
+/***                                                                       ***/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+    With AVRX_GOVERNOR the timer handler counts the ticks that find the
+    system idle.  At the end of every window of AVRX_GOV_WINDOW ticks the
+    system clock is divided by two more (up to 2^AVRX_GOV_MAXSHIFT) if
+    more than AVRX_GOV_SLOW percent of them were idle, and put straight
+    back to full speed if fewer than AVRX_GOV_FAST percent were.  Needs a
+    part with the CLKPR clock prescaler.
+
+    The tick timer runs from the system clock, so its reload value has to
+    follow.  The tick interrupt handler reloads from AvrXTickReload rather
+    than a constant, and AvrXGovernorInit() is given the full speed value:
+
+        AVRX_SIGINT(TIMER0_OVF_vect)
+        {
+            AvrXEnterKernel();
+            TCNT0 = AvrXTickReload;
+            AvrXTimerHandler();
+            AvrXLeaveKernel();
+        }
+
+        AvrXGovernorInit(TCNT0_INIT);
+
+    The clock, the reload value and the count left in the current tick
+    (AVRX_TICK_TCNT, TCNT0 unless defined otherwise) change together with
+    interrupts off, so ticks keep their length across a switch.  The
+    clock is only divided by powers of two that divide the tick period
+    (in timer counts) exactly, and never below 2 counts a tick, so a tick
+    whose period is odd is never slowed at all.  Pick the timer prescaler
+    and TICKRATE so the period is a multiple of 2^AVRX_GOV_MAXSHIFT.
+
+    Anything else that depends on the clock rate (baud rates, PWM, busy
+    waits) should hold the clock at full speed while it needs it.
+*/
+#ifndef AVRX_GOV_WINDOW
+#  define AVRX_GOV_WINDOW   100     /* Ticks per measurement (max 255) */
+#endif
+#ifndef AVRX_GOV_SLOW
+#  define AVRX_GOV_SLOW     60      /* Idle percent above which to slow */
+#endif
+#ifndef AVRX_GOV_FAST
+#  define AVRX_GOV_FAST     20      /* Idle percent below which to speed up */
+#endif
+#ifndef AVRX_GOV_MAXSHIFT
+#  define AVRX_GOV_MAXSHIFT 3       /* Slowest clock is 1/8 */
+#endif
+#ifndef AVRX_TICK_TCNT
+#  define AVRX_TICK_TCNT    TCNT0
+#endif
+
+extern uint8_t AvrXTickReload;
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXGovernorInit
+ *
+ *  SYNOPSIS
+ *      void AvrXGovernorInit(uint8_t reload)
+ *
+ *  DESCRIPTION
+ *      Sets the tick timer's reload value at full speed and starts the
+ *      governor at full speed.  Call from main() before the tick starts.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXGovernorInit(uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXClockHold
+ *      AvrXClockRelease
+ *
+ *  SYNOPSIS
+ *      void AvrXClockHold(void)
+ *      void AvrXClockRelease(void)
+ *
+ *  DESCRIPTION
+ *      Put the clock to full speed at once and keep it there until the
+ *      matching release.  Holds are counted.  Callable from tasks and
+ *      interrupt handlers.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXClockHold(void);
+extern void AvrXClockRelease(void);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXClockShift
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXClockShift(void)
+ *
+ *  DESCRIPTION
+ *      Gets the current clock division as a power of two.
+ *
+ *  RETURNS
+ *      0 at full speed, 1 for half speed and so on
+ *
+ *****************************************************************************/
+extern uint8_t AvrXClockShift(void);
+#endif /* AVRX_GOVERNOR */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/***                                                                       ***/
+/***           S T A C K   R E S O U R C E   P O L I C Y   J O B S         ***/
+/***                                                                       ***/
+/*****************************************************************************/
+/*****************************************************************************/
+
+/*
+    SRP jobs are run-to-completion functions that never block.  Each has
+    a level from 0 (most urgent) to AVRX_SRP_LEVELS-1.  Ready jobs run
+    ahead of all AvrX tasks, on the kernel stack, and preempt each other
+    by nesting like interrupts, so the stack needed grows with the number
+    of levels in use rather than the number of jobs.  Ordinary AvrX tasks
+    on the run queue carry on blocking as usual whenever no job is ready.
+
+    Shared data is protected with immediate priority ceilings: a resource
+    has a ceiling equal to the most urgent level of any job using it, and
+    holding it defers every job at or below that level.
+
+        uint8_t c = AvrXSrpLock(BUFFER_CEILING);
+            ... use buffer ...
+        AvrXSrpUnlock(c);
+
+    Locks must be released in reverse order, and a task must not block or
+    yield while it holds one.  Jobs may call the non-blocking AvrX APIs
+    (set semaphore, send message, start timer) but never wait.
+
+    From an interrupt handler, post with AvrXIntSrpPost() and call
+    AvrXSrpDispatch() just before AvrXLeaveKernel().
+*/
+#define AVRX_SRP_LEVELS 8
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSrpRegister
+ *
+ *  SYNOPSIS
+ *      void AvrXSrpRegister(uint8_t level, void (*job)(void))
+ *
+ *  DESCRIPTION
+ *      Installs 'job' as the SRP job at 'level'.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSrpRegister(uint8_t, void (*)(void));
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSrpPost
+ *      AvrXIntSrpPost
+ *
+ *  SYNOPSIS
+ *      void AvrXSrpPost(uint8_t level)
+ *      void AvrXIntSrpPost(uint8_t level)
+ *
+ *  DESCRIPTION
+ *      Makes the job at 'level' ready.  AvrXSrpPost runs it straight away
+ *      if it is above the current ceiling.  AvrXIntSrpPost only marks it
+ *      ready; the interrupt handler must then call AvrXSrpDispatch().
+ *      Posting a job that is already ready has no further effect.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSrpPost(uint8_t);
+extern void AvrXIntSrpPost(uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSrpDispatch
+ *
+ *  SYNOPSIS
+ *      void AvrXSrpDispatch(void)
+ *
+ *  DESCRIPTION
+ *      Runs every ready job above the current ceiling, most urgent first.
+ *      Kernel context only (inside AvrXEnterKernel/AvrXLeaveKernel).
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSrpDispatch(void);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSrpLock
+ *      AvrXSrpUnlock
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXSrpLock(uint8_t ceiling)
+ *      void AvrXSrpUnlock(uint8_t previous)
+ *
+ *  DESCRIPTION
+ *      Raise the system ceiling to a resource's ceiling level, and restore
+ *      it afterwards.  Unlock runs any jobs that were deferred.
+ *
+ *  RETURNS
+ *      AvrXSrpLock returns the previous ceiling, to pass to AvrXSrpUnlock
+ *
+ *****************************************************************************/
+extern uint8_t AvrXSrpLock(uint8_t);
+extern void AvrXSrpUnlock(uint8_t);
+
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
@@ -0,0 +1,373 @@
+/*
+    avrx.hpp - AvrX C++ Interface
+
+    Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the
+    Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+    Boston, MA  02111-1307, USA.
+
+    http://www.gnu.org/copyleft/lgpl.html
+*/
+
+#ifndef AVRXCPPHEADER
+#define AVRXCPPHEADER
+
+/*
+    Thin C++ wrappers over the C interface in avrx.h.  Every method is an
+    inline call of the C function (or header fast path) it is named after,
+    and every object holds just the C structure, so there are no vtables,
+    no heap and no code beyond what the C calls would produce.  Objects
+    have constexpr constructors, so statics are set up at link time rather
+    than by startup code.  Native() hands back the C object for calls
+    that have no wrapper.  Needs C++11; there is no standard library.
+
+        void Blink(void) CTASK;
+        typedef avrx::Task<Blink, 20 + MINCONTEXT, 3> BlinkTask;
+        avrx::Semaphore Port;
+        avrx::Timer Tick;
+
+        void Blink(void)
+        {
+            while(1)
+            {
+                Tick.Delay(500);
+                avrx::Lock<avrx::Semaphore> l(Port);
+                ...
+            }
+        }
+
+        int main(void)
+        {
+            AvrXSetKernelStack(0);
+            ...
+            BlinkTask::Run();
+            AvrXLeaveKernel();
+        }
+*/
+
+extern "C" {
+#include "avrx.h"
+}
+
+namespace avrx {
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Task<Entry, StackSize, Prio>
+ *
+ *  DESCRIPTION
+ *      The stack, process ID and task control block of one task, as laid
+ *      down by AVRX_TASK().  StackSize is the stack including the saved
+ *      context, and is checked against MINCONTEXT at compile time.  Like
+ *      AVRX_TASK(), AVRX_RESTORE_STACK is added on top.
+ *
+ *      Run() is AvrXRunTask() on the control block.  Start() does the
+ *      same job with most of it done by the linker: the process ID is
+ *      initialised data already pointing at a zeroed register image in
+ *      the stack, so only the entry address is stored before the resume.
+ *      Use Run() to restart a task that has terminated.
+ *
+ *****************************************************************************/
+
+template <void (*Entry)(void), uint16_t StackSize, uint8_t Prio>
+class Task
+{
+    static_assert(StackSize > MINCONTEXT,
+                  "task stack must hold at least the saved context");
+
+    static const uint16_t Size = StackSize + AVRX_RESTORE_STACK;
+
+    static uint8_t stack[Size];
+    static ProcessID pid;
+    static TaskControlBlock tcb;
+
+public:
+    static pProcessID Pid(void) { return &pid; }
+    static TaskControlBlock *Tcb(void) { return &tcb; }
+
+    static void Run(void) { AvrXRunTask(&tcb); }
+    static pProcessID Init(void) { return AvrXInitTask(&tcb); }
+
+    static void Start(void)
+    {
+        uint16_t a = reinterpret_cast<uint16_t>(Entry);
+
+        stack[Size - 1] = a;                // Pushed low byte first
+        stack[Size - 2] = a >> 8;
+        AvrXResume(&pid);
+    }
+
+    static void Resume(void) { AvrXResume(&pid); }
+    static void Suspend(void) { AvrXSuspend(&pid); }
+    static void Terminate(void) { AvrXTerminate(&pid); }
+    static uint8_t Priority(void) { return AvrXPriority(&pid); }
+    static uint8_t ChangePriority(uint8_t p)
+        { return AvrXChangePriority(&pid, p); }
+};
+
+template <void (*Entry)(void), uint16_t StackSize, uint8_t Prio>
+uint8_t Task<Entry, StackSize, Prio>::stack[Size];
+
+template <void (*Entry)(void), uint16_t StackSize, uint8_t Prio>
+ProcessID Task<Entry, StackSize, Prio>::pid =
+{
+    NOPID,
+    AVRX_PID_Suspend | AVRX_PID_Suspended,
+    Prio,
+#ifdef AVRX_DLIST
+    0,
+#endif
+    &stack[Size - 1 - MINCONTEXT]           // As left by AvrXInitTask()
+};                                          // Any other fields are zero
+
+template <void (*Entry)(void), uint16_t StackSize, uint8_t Prio>
+TaskControlBlock Task<Entry, StackSize, Prio>::tcb PROGMEM =
+{
+    &stack[Size - 1],
+    Entry,
+    &pid,
+    Prio
+};
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      TaskTable<Tasks...>
+ *
+ *  DESCRIPTION
+ *      A fixed set of tasks, started together from main():
+ *
+ *          typedef avrx::TaskTable<BlinkTask, MonitorTask> AllTasks;
+ *          AllTasks::Start();
+ *
+ *      The calls are unrolled at compile time; there is no table in RAM.
+ *
+ *****************************************************************************/
+
+template <class... Tasks>
+struct TaskTable
+{
+    static void Run(void)
+    {
+        int unused[] = {0, (Tasks::Run(), 0)...};
+        (void)unused;
+    }
+
+    static void Start(void)
+    {
+        int unused[] = {0, (Tasks::Start(), 0)...};
+        (void)unused;
+    }
+};
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Semaphore
+ *
+ *  DESCRIPTION
+ *      A Mutex, starting as AVRX_SEM_PEND like AVRX_MUTEX().
+ *
+ *****************************************************************************/
+
+class Semaphore
+{
+    Mutex m;
+
+public:
+    constexpr Semaphore() : m(AVRX_SEM_PEND) {}
+
+    void Set(void) { AvrXSetSemaphore(&m); }
+    void IntSet(void) { AvrXIntSetSemaphore(&m); }
+    void Wait(void) { AvrXWaitSemaphore(&m); }
+    Mutex Test(void) { return AvrXTestSemaphore(&m); }
+    void Reset(void) { AvrXResetSemaphore(&m); }
+    void Broadcast(void) { AvrXBroadcastSemaphore(&m); }
+
+    pMutex Native(void) { return &m; }
+};
+
+static_assert(sizeof(Semaphore) == sizeof(Mutex), "Semaphore must be a Mutex");
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Latest<T>
+ *
+ *  DESCRIPTION
+ *      A value of type T guarded by a SeqLock.  Read() returns the
+ *      sequence to hand to Wait().
+ *
+ *****************************************************************************/
+
+template <class T>
+class Latest
+{
+    ::SeqLock l;
+    T value;
+
+public:
+    constexpr Latest() : l(), value() {}
+
+    void Write(const T &v) { AvrXSeqWrite(&l, &value, &v, sizeof(T)); }
+    void IntWrite(const T &v) { AvrXIntSeqWrite(&l, &value, &v, sizeof(T)); }
+    uint8_t Read(T &v) { return AvrXSeqRead(&l, &v, &value, sizeof(T)); }
+    void Wait(uint8_t seq) { AvrXSeqWait(&l, seq); }
+
+    pSeqLock Native(void) { return &l; }
+};
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Timer
+ *
+ *  DESCRIPTION
+ *      A TimerControlBlock and the calls that take one.
+ *
+ *****************************************************************************/
+
+class Timer
+{
+    TimerControlBlock t;
+
+public:
+    constexpr Timer() : t() {}
+
+    void Start(uint16_t count) { AvrXStartTimer(&t, count); }
+    void StartSlack(uint16_t count, uint16_t slack)
+        { AvrXStartTimerSlack(&t, count, slack); }
+    void IntStart(uint16_t count) { AvrXIntStartTimer(&t, count); }
+    pTimerControlBlock Cancel(void) { return AvrXCancelTimer(&t); }
+    void Wait(void) { AvrXWaitTimer(&t); }
+    Mutex Test(void) { return AvrXTestTimer(&t); }
+    void Delay(uint16_t count) { AvrXDelay(&t, count); }
+    void DelaySlack(uint16_t count, uint16_t slack)
+        { AvrXDelaySlack(&t, count, slack); }
+
+    pTimerControlBlock Native(void) { return &t; }
+};
+
+static_assert(sizeof(Timer) == sizeof(TimerControlBlock),
+              "Timer must be a TimerControlBlock");
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Message, MessageQueue<T>
+ *
+ *  DESCRIPTION
+ *      Typed messages.  A message type derives from Message, which holds
+ *      the MessageControlBlock, and a MessageQueue<T> only passes T:
+ *
+ *          struct Reading : avrx::Message { uint16_t value; };
+ *          avrx::MessageQueue<Reading> Readings;
+ *
+ *          Reading *r = Readings.Wait();
+ *          ...
+ *          r->Ack();
+ *
+ *****************************************************************************/
+
+class Message
+{
+    MessageControlBlock mcb;
+
+public:
+    constexpr Message() : mcb() {}
+
+    void Ack(void) { AvrXAckMessage(&mcb); }
+    void WaitAck(void) { AvrXWaitMessageAck(&mcb); }
+    Mutex TestAck(void) { return AvrXTestMessageAck(&mcb); }
+
+    pMessageControlBlock Native(void) { return &mcb; }
+};
+
+template <class T>
+class MessageQueue
+{
+    static_assert(__is_base_of(Message, T),     // No <type_traits> here
+                  "message type must derive from avrx::Message");
+
+    ::MessageQueue q;
+
+    static pMessageControlBlock C(T &msg)
+        { return static_cast<Message &>(msg).Native(); }
+    static T *Cpp(pMessageControlBlock p)
+        { return static_cast<T *>(reinterpret_cast<Message *>(p)); }
+
+public:
+    constexpr MessageQueue() : q() {}
+
+    void Send(T &msg) { AvrXSendMessage(&q, C(msg)); }
+    void IntSend(T &msg) { AvrXIntSendMessage(&q, C(msg)); }
+    void Call(T &msg) { AvrXCall(&q, C(msg)); }
+    T *Recv(void) { return Cpp(AvrXRecvMessage(&q)); }
+    T *Wait(void) { return Cpp(AvrXWaitMessage(&q)); }
+
+    pMessageQueue Native(void) { return &q; }
+};
+
+/*****************************************************************************
+ *
+ *  CLASS
+ *      Critical, SchedLock, Lock<S>
+ *
+ *  DESCRIPTION
+ *      Scope guards.  Critical is AvrXEnterCritical()/AvrXLeaveCritical(),
+ *      SchedLock is AvrXSchedLock()/AvrXSchedUnlock() and Lock waits on a
+ *      semaphore and sets it again when the scope ends.
+ *
+ *****************************************************************************/
+
+class Critical
+{
+    uint8_t sreg;
+
+public:
+    Critical() : sreg(AvrXEnterCritical()) {}
+    ~Critical() { AvrXLeaveCritical(sreg); }
+
+    Critical(const Critical &) = delete;
+    Critical &operator=(const Critical &) = delete;
+};
+
+class SchedLock
+{
+public:
+    SchedLock() { AvrXSchedLock(); }
+    ~SchedLock() { AvrXSchedUnlock(); }
+
+    SchedLock(const SchedLock &) = delete;
+    SchedLock &operator=(const SchedLock &) = delete;
+};
+
+template <class S>
+class Lock
+{
+    S &s;
+
+public:
+    explicit Lock(S &sem) : s(sem) { s.Wait(); }
+    ~Lock() { s.Set(); }
+
+    Lock(const Lock &) = delete;
+    Lock &operator=(const Lock &) = delete;
+};
+
+} // namespace avrx
+
+#endif /* AVRXCPPHEADER */
@@ -0,0 +1,207 @@
+/*
+    avrxeecache.h - AvrX Utility - Write-back EEPROM cache
+
+    Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the
+    Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+    Boston, MA  02111-1307, USA.
+
+    http://www.gnu.org/copyleft/lgpl.html
+*/
+
+/*****************************************************************************/
+#ifndef AVRXEECACHE_H
+#define AVRXEECACHE_H
+/*****************************************************************************/
+
+#include "avrx.h"
+
+/*
+    The EEPROM cache keeps a RAM mirror of a window of EEPROM.  Reads
+    inside the window are plain RAM loads and never take the EEPROM mutex.
+    Writes update the mirror and mark the containing line dirty; dirty
+    lines are written back by AvrXEECacheFlush(), typically from a low
+    priority task:
+
+        AVRX_TASKDEF(flusher, 10, 250)
+        {
+            while (1)
+            {
+                AvrXEECacheWaitDirty(&Config);
+                AvrXEECacheFlush(&Config);
+            }
+        }
+
+    Addresses outside the window fall through to the uncached EEPROM
+    routines.
+*/
+typedef struct EECache
+{
+    uint8_t *base;          // Start of the cached window in EEPROM
+    uint8_t *ram;           // RAM mirror of the window
+    uint8_t *dirty;         // Dirty bits, one per line
+    uint16_t size;          // Window size in bytes
+    uint8_t  linesz;        // Bytes per line
+    Mutex    dirtysem;      // Set when a clean line becomes dirty
+    Mutex    flushlock;     // Serialises flushes
+}
+* pEECache, EECache;
+
+#define AVRX_EECACHE_LINES(size, linesz) \
+    (((size) + (linesz) - 1) / (linesz))
+
+#define AVRX_EECACHE(A, base, size, linesz) \
+    uint8_t A ## Ram [size]; \
+    uint8_t A ## Dirty [(AVRX_EECACHE_LINES(size, linesz) + 7) / 8]; \
+    EECache A = \
+    { \
+        (uint8_t *)(base), \
+        A##Ram, \
+        A##Dirty, \
+        size, \
+        linesz, \
+        AVRX_SEM_PEND, \
+        AVRX_SEM_PEND \
+    }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheInit
+ *
+ *  SYNOPSIS
+ *      void AvrXEECacheInit(pEECache pCache)
+ *
+ *  DESCRIPTION
+ *      Loads the window into the RAM mirror and marks all lines clean.
+ *      The EEPROM driver must already have been set up with
+ *      AvrXEEPromInit().  Must be called from a task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEECacheInit(pEECache);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheRead
+ *      AvrXEECacheReadWord
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXEECacheRead(pEECache pCache, const uint8_t *p)
+ *      uint16_t AvrXEECacheReadWord(pEECache pCache, const uint16_t *p)
+ *
+ *  DESCRIPTION
+ *      Reads a byte or word at EEPROM address 'p'.  Served from RAM when
+ *      'p' is inside the window.  The word read is atomic with respect to
+ *      writers and is safe in interrupt handlers when inside the window.
+ *
+ *  RETURNS
+ *      The read byte or word
+ *
+ *****************************************************************************/
+extern uint8_t AvrXEECacheRead(pEECache, const uint8_t *);
+extern uint16_t AvrXEECacheReadWord(pEECache, const uint16_t *);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheWrite
+ *      AvrXEECacheWriteWord
+ *
+ *  SYNOPSIS
+ *      void AvrXEECacheWrite(pEECache pCache, uint8_t *p, uint8_t b)
+ *      void AvrXEECacheWriteWord(pEECache pCache, uint16_t *p, uint16_t w)
+ *
+ *  DESCRIPTION
+ *      Writes a byte or word to EEPROM address 'p'.  Inside the window
+ *      only the RAM mirror is updated and the line marked dirty; the
+ *      EEPROM is written by the next flush.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEECacheWrite(pEECache, uint8_t *, uint8_t);
+extern void AvrXEECacheWriteWord(pEECache, uint16_t *, uint16_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheFlush
+ *
+ *  SYNOPSIS
+ *      void AvrXEECacheFlush(pEECache pCache)
+ *
+ *  DESCRIPTION
+ *      Writes every dirty line back to EEPROM.  Only bytes that differ
+ *      from the EEPROM contents are written.  Must be called from a task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEECacheFlush(pEECache);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheSync
+ *
+ *  SYNOPSIS
+ *      void AvrXEECacheSync(pEECache pCache)
+ *
+ *  DESCRIPTION
+ *      Returns once everything written to the cache before the call is in
+ *      EEPROM.  Flushes are serialised, so this first waits for a flush
+ *      already in progress in another task (which may have taken lines
+ *      this one would otherwise see as clean) and then flushes the rest.
+ *      Must be called from a task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+#define AvrXEECacheSync(A) \
+        AvrXEECacheFlush(A)
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEECacheWaitDirty
+ *
+ *  SYNOPSIS
+ *      void AvrXEECacheWaitDirty(pEECache pCache)
+ *
+ *  DESCRIPTION
+ *      Blocks until a line has been made dirty since the last wait.
+ *      Intended for a background flush task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+#define AvrXEECacheWaitDirty(A) \
+        AvrXWaitSemaphore(&(A)->dirtysem)
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+#endif /* AVRXEECACHE_H */
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,178 @@
+/*
+    avrxeelog.h - AvrX Utility - Wear-levelled EEPROM record log
+
+    Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the
+    Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+    Boston, MA  02111-1307, USA.
+
+    http://www.gnu.org/copyleft/lgpl.html
+*/
+
+/*****************************************************************************/
+#ifndef AVRXEELOG_H
+#define AVRXEELOG_H
+/*****************************************************************************/
+
+#include "avrx.h"
+
+/*
+    The EEPROM log is a small key/value store laid out as a ring of fixed
+    size slots in a region of EEPROM.  Each write appends a new record to
+    the next slot in the ring, so every slot is rewritten once per lap of
+    the ring rather than the same cells being rewritten on every update.
+
+    Each slot holds:
+
+        [key][seq][len][data ... datasz bytes]
+
+    key  - record key (0 to nkeys-1), 0xFF marks a free/invalid slot
+    seq  - 8-bit sequence number, incremented on every append
+    len  - number of valid data bytes, 0 marks the key as deleted
+
+    At init the ring is scanned once to find the write position (the first
+    break in the sequence numbers) and to build a RAM index holding the
+    slot of the latest record for each key.  After that, locating a record
+    never touches the EEPROM and a write only touches the bytes of the new
+    record.
+
+    Compaction is lazy: when the write position reaches a slot that still
+    holds the latest record for its key, that slot is given a new sequence
+    number in place (a one byte write) and the write moves on.  The number
+    of slots must therefore be greater than the number of keys.
+*/
+typedef struct EELog
+{
+    uint8_t *base;          // Start of the log region in EEPROM
+    uint8_t *index;         // RAM index: slot of latest record per key
+    uint8_t  nslots;        // Number of slots in the ring (2-255)
+    uint8_t  datasz;        // Data bytes per slot
+    uint8_t  nkeys;         // Number of keys (< nslots)
+    uint8_t  head;          // Next slot to write
+    uint8_t  seq;           // Next sequence number
+    Mutex    mutex;         // Serialises writers
+}
+* pEELog, EELog;
+
+#define AVRX_EELOG_HDRSZ    3           // key, seq and len bytes
+#define AVRX_EELOG_NOSLOT   0xFF        // Index entry for an absent key
+
+#define AVRX_EELOG_SIZE(nslots, datasz) \
+    ((uint16_t)(nslots) * ((datasz) + AVRX_EELOG_HDRSZ))
+
+/*
+    Declare a log and its RAM index.  'base' is an EEPROM address and the
+    region occupies AVRX_EELOG_SIZE(nslots, datasz) bytes from there.
+    Fewer keys than slots is checked at compile time.
+*/
+#define AVRX_EELOG(A, base, nslots, datasz, nkeys) \
+    _Static_assert((nkeys) < (nslots), "AVRX_EELOG needs more slots than keys"); \
+    uint8_t A ## Index [nkeys]; \
+    EELog A = \
+    { \
+        (uint8_t *)(base), \
+        A##Index, \
+        nslots, \
+        datasz, \
+        nkeys, \
+        0, \
+        0, \
+        AVRX_SEM_PEND \
+    }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEELogInit
+ *
+ *  SYNOPSIS
+ *      void AvrXEELogInit(pEELog pLog)
+ *
+ *  DESCRIPTION
+ *      Scans the log region, finds the write position and builds the RAM
+ *      index.  The EEPROM driver must already have been set up with
+ *      AvrXEEPromInit().  Must be called from a task.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXEELogInit(pEELog);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEELogRead
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXEELogRead(pEELog pLog, uint8_t key, void *buf, uint8_t sz)
+ *
+ *  DESCRIPTION
+ *      Copies up to 'sz' bytes of the latest record for 'key' into 'buf'.
+ *
+ *  RETURNS
+ *      Number of bytes copied, 0 if the key has no record
+ *
+ *****************************************************************************/
+extern uint8_t AvrXEELogRead(pEELog, uint8_t, void *, uint8_t);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEELogWrite
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXEELogWrite(pEELog pLog, uint8_t key, const void *buf,
+ *                             uint8_t len)
+ *
+ *  DESCRIPTION
+ *      Appends a new record of 'len' bytes for 'key'.  A length of 0
+ *      deletes the key.
+ *
+ *  RETURNS
+ *      Number of bytes written, 0 if the key or length is out of range.
+ *      A delete always returns 0.
+ *
+ *****************************************************************************/
+extern uint8_t AvrXEELogWrite(pEELog, uint8_t, const void *, uint8_t);
+
+#define AvrXEELogDelete(A, key) \
+        AvrXEELogWrite((A), (key), 0, 0)
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXEELogLookup
+ *
+ *  SYNOPSIS
+ *      uint8_t AvrXEELogLookup(pEELog pLog, uint8_t key)
+ *
+ *  DESCRIPTION
+ *      Checks the RAM index for a key.  Does not touch the EEPROM.
+ *
+ *  RETURNS
+ *      Slot holding the latest record, or AVRX_EELOG_NOSLOT
+ *
+ *****************************************************************************/
+#define AvrXEELogLookup(A, key) \
+        ((A)->index[(key)])
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+#endif /* AVRXEELOG_H */
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,161 @@
+/*
+    avrxworkq.h - AvrX Utility - Worker task job queues
+
+    Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the
+    Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+    Boston, MA  02111-1307, USA.
+
+    http://www.gnu.org/copyleft/lgpl.html
+*/
+
+/*****************************************************************************/
+#ifndef AVRXWORKQ_H
+#define AVRXWORKQ_H
+/*****************************************************************************/
+
+#include "avrx.h"
+
+/*
+    A work queue lets a few worker tasks run many short jobs, instead of
+    giving each job its own task and stack.  A job is a message carrying a
+    function and an argument; the message acknowledge semaphore is the
+    job's completion semaphore.
+
+    Jobs are queued on one of several lanes.  Lane 0 is the most urgent:
+    a worker always takes the oldest job from the lowest numbered non-empty
+    lane.  Workers run each job to completion, so a job must not wait for
+    another job on the same queue unless there are spare workers.
+
+        AVRX_WORKQ(Jobs, 2);
+        AVRX_WORKER(worker1, 40, 5, Jobs);
+        AVRX_WORKER(worker2, 40, 5, Jobs);
+
+        AVRX_JOB(blink);
+            .
+        AvrXRunTask(TCB(worker1));
+        AvrXRunTask(TCB(worker2));
+            .
+        AvrXSubmitJob(&Jobs, 1, &blink, BlinkLed, (void *)3);
+        AvrXWaitJob(&blink);
+*/
+typedef void (*AvrXJobFunc)(void *);
+
+typedef struct WorkJob
+{
+    MessageControlBlock mcb;        // Must be first, ack = completion
+    AvrXJobFunc         func;
+    void               *arg;
+}
+* pWorkJob, WorkJob;
+
+typedef struct WorkQueue
+{
+    pMessageQueue lanes;            // Job queues, lane 0 first
+    uint8_t       nlanes;
+    Mutex         ready;            // Set when a job is submitted
+}
+* pWorkQueue, WorkQueue;
+
+#define AVRX_JOB(A) \
+        WorkJob A
+
+#define AVRX_WORKQ(A, nlanes) \
+    MessageQueue A ## Lanes [nlanes]; \
+    WorkQueue A = \
+    { \
+        A##Lanes, \
+        nlanes, \
+        AVRX_SEM_PEND \
+    }
+
+#define AVRX_WORKER(start, c_stack, priority, queue) \
+    AVRX_TASKDEF(start, c_stack, priority) \
+    { \
+        AvrXWorkerRun(&queue); \
+    }
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXSubmitJob
+ *      AvrXIntSubmitJob
+ *
+ *  SYNOPSIS
+ *      void AvrXSubmitJob(pWorkQueue q, uint8_t lane, pWorkJob job,
+ *                         AvrXJobFunc func, void *arg)
+ *      void AvrXIntSubmitJob(pWorkQueue q, uint8_t lane, pWorkJob job,
+ *                            AvrXJobFunc func, void *arg)
+ *
+ *  DESCRIPTION
+ *      Queues 'job' to run 'func(arg)' on lane 'lane' and wakes a worker.
+ *      The job must not already be queued or running.
+ *      The Int version is safe to be called from within an interrupt handler.
+ *
+ *  RETURNS
+ *      none
+ *
+ *****************************************************************************/
+extern void AvrXSubmitJob(pWorkQueue, uint8_t, pWorkJob, AvrXJobFunc, void *);
+extern void AvrXIntSubmitJob(pWorkQueue, uint8_t, pWorkJob, AvrXJobFunc, void *);
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXWaitJob
+ *      AvrXTestJob
+ *
+ *  SYNOPSIS
+ *      void AvrXWaitJob(pWorkJob job)
+ *      Mutex AvrXTestJob(pWorkJob job)
+ *
+ *  DESCRIPTION
+ *      Blocking wait for, or non-blocking test of, job completion.
+ *
+ *  RETURNS
+ *      AvrXTestJob returns AVRX_SEM_DONE once the job has completed
+ *
+ *****************************************************************************/
+#define AvrXWaitJob(A) \
+        AvrXWaitMessageAck(&(A)->mcb)
+
+#define AvrXTestJob(A) \
+        AvrXTestMessageAck(&(A)->mcb)
+
+/*****************************************************************************
+ *
+ *  FUNCTION
+ *      AvrXWorkerRun
+ *
+ *  SYNOPSIS
+ *      void AvrXWorkerRun(pWorkQueue q)
+ *
+ *  DESCRIPTION
+ *      Body of a worker task: takes jobs from 'q' and runs them, forever.
+ *      Normally used through AVRX_WORKER().
+ *
+ *  RETURNS
+ *      Never returns
+ *
+ *****************************************************************************/
+extern void AvrXWorkerRun(pWorkQueue) CTASK;
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
+#endif /* AVRXWORKQ_H */
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,55 @@
+/*
+ 	avrx_barrier.c - Barrier synchronisation
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include "avrx.h"
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Interrupts stay disabled from the count going up to this task being
+	queued on the semaphore (AvrXWaitSemaphore keeps them off into the
+	kernel), so the last task cannot broadcast in between and leave an
+	earlier arrival waiting for a release that has already happened.
+	The count is reset before the broadcast, so released tasks can start
+	the next round straight away.
+**/
+uint8_t AvrXBarrierWait(pBarrier pBar)
+{
+	BeginCritical();
+	if (++pBar->count < pBar->ntasks)
+	{
+		AvrXWaitSemaphore(&pBar->sem);
+		return 0;
+	}
+	pBar->count = 0;
+	EndCritical();
+
+	AvrXBroadcastSemaphore(&pBar->sem);
+	return 1;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,101 @@
+/*
+ 	avrx_edf.c - Earliest deadline first scheduling
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+
+#ifdef AVRX_EDF
+
+/*****************************************************************************/
+uint16_t _EdfTicks;
+
+/*****************************************************************************/
+uint16_t AvrXEdfNow(void)
+{
+	uint16_t t;
+
+	uint8_t sreg = AvrXEnterCritical();
+	t = _EdfTicks;
+	AvrXLeaveCritical(sreg);
+
+	return t;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The first job is released now.  If the task is already on the run
+	queue it is re-sorted by its new deadline.
+**/
+void AvrXEdfSetPeriod(pProcessID p, uint16_t period, uint16_t deadline)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	p->period      = period;
+	p->reldeadline = deadline;
+	p->deadline    = _EdfTicks + deadline;
+	p->misses      = 0;
+	AvrXLeaveCritical(sreg);
+
+	AvrXChangePriority(p, p->priority);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Releases are kept on the period grid (release = previous release +
+	period) rather than drifting with completion times.  The deadline is
+	moved on before the task blocks so that, when the timer releases it,
+	_QueuePid sorts it by the deadline of its next job.
+
+	A job that overran its next release is started straight away; the
+	task is re-sorted behind any job with an earlier deadline.
+**/
+void AvrXEdfWaitPeriod(pTimerControlBlock pTCB)
+{
+	pProcessID p = AvrXSelf();
+	uint16_t now, release;
+
+	uint8_t sreg = AvrXEnterCritical();
+	now = _EdfTicks;
+	if ((int16_t)(now - p->deadline) > 0 && p->misses != 0xFF)
+		p->misses++;
+	release     = p->deadline - p->reldeadline + p->period;
+	p->deadline = release + p->reldeadline;
+	AvrXLeaveCritical(sreg);
+
+	if ((int16_t)(release - now) > 0)
+		AvrXDelay(pTCB, release - now);
+	else
+		AvrXChangePriority(p, p->priority);
+}
+
+#endif /* AVRX_EDF */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,166 @@
+/*
+ 	avrx_governor.c - System clock scaling by measured idle time
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/power.h>
+
+#include "avrx.h"
+
+#ifdef AVRX_GOVERNOR
+
+#ifndef CLKPR
+#  error "AVRX_GOVERNOR needs a part with the CLKPR clock prescaler"
+#endif
+
+extern struct AvrXKernelData AvrXKernelData;
+
+void _GovernorTick(void);
+
+#define SLOW_TICKS ((uint8_t)((uint16_t)AVRX_GOV_WINDOW * AVRX_GOV_SLOW / 100))
+#define FAST_TICKS ((uint8_t)((uint16_t)AVRX_GOV_WINDOW * AVRX_GOV_FAST / 100))
+
+uint8_t AvrXTickReload;
+
+static uint16_t Period;         // Timer counts per tick at full speed
+static uint8_t  Shift;
+static uint8_t  MaxShift;
+static uint8_t  Holds;
+static uint8_t  Ticks;
+static uint8_t  IdleTicks;
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Switches the clock to 1/2^shift.  The counts left until the next tick
+	are scaled with it, so the tick in progress keeps its length (to within
+	a count of the slower clock), and the next reload matches the new
+	clock.  All with interrupts off.
+**/
+static void SetShift(uint8_t shift)
+{
+	uint16_t left;
+
+	uint8_t sreg = SREG;
+	cli();
+	left = 256 - AVRX_TICK_TCNT;
+	if (shift > Shift)
+		left >>= shift - Shift;
+	else
+		left <<= Shift - shift;
+	if (left == 0)
+		left = 1;
+	clock_prescale_set((clock_div_t)shift);
+	AVRX_TICK_TCNT = 256 - left;
+	AvrXTickReload = 256 - (Period >> shift);
+	Shift = shift;
+	SREG = sreg;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The clock is only divided as far as the tick period still divides
+	exactly, so a slowed tick is exactly as long as a full speed one.
+**/
+void AvrXGovernorInit(uint8_t reload)
+{
+	uint8_t sreg = AvrXEnterCritical();
+
+	Period = 256 - reload;
+	for (MaxShift = 0; MaxShift < AVRX_GOV_MAXSHIFT; MaxShift++)
+		if ((Period >> (MaxShift + 1)) < 2 || (Period & ((2 << MaxShift) - 1)))
+			break;
+	Ticks = IdleTicks = 0;
+	AvrXTickReload = reload;
+	Shift = 0;
+	clock_prescale_set(clock_div_1);
+
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+void AvrXClockHold(void)
+{
+	uint8_t sreg = AvrXEnterCritical();
+
+	Holds++;
+	if (Shift != 0)
+		SetShift(0);
+
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+void AvrXClockRelease(void)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	Holds--;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+uint8_t AvrXClockShift(void)
+{
+	return Shift;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called from AvrXTimerHandler, in kernel context, once per tick.  A tick
+	that finds no task running counts as idle.  At the end of a window the
+	clock is slowed one step if the system was mostly idle, or put back to
+	full speed at once if it was busy.
+**/
+void _GovernorTick(void)
+{
+	uint8_t sreg = AvrXEnterCritical();
+
+	if (AvrXKernelData.Running == NOPID)
+		IdleTicks++;
+
+	if (++Ticks >= AVRX_GOV_WINDOW)
+	{
+		if (Holds == 0)
+		{
+			if (IdleTicks > SLOW_TICKS && Shift < MaxShift)
+				SetShift(Shift + 1);
+			else if (IdleTicks < FAST_TICKS && Shift != 0)
+				SetShift(0);
+		}
+		Ticks = IdleTicks = 0;
+	}
+
+	AvrXLeaveCritical(sreg);
+}
+
+#endif /* AVRX_GOVERNOR */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,209 @@
+/*
+ 	avrx_inttimer.c - Starting and cancelling timers from interrupt handlers
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+
+#define TIMERMESSAGE_EV	((Mutex)2)	// See avrx.inc
+
+#define REQ_CANCEL	0
+#define REQ_START	1
+#define REQ_MESSAGE	2
+
+extern uint8_t _TimQLevel;
+
+extern void _TimerInsert(pTimerControlBlock, uint16_t, uint16_t);
+extern pTimerControlBlock _TimerRemove(pTimerControlBlock);
+extern void _TimerRelease(void);
+
+/*****************************************************************************/
+static struct
+{
+	pTimerControlBlock tcb;
+	uint16_t count;
+	uint8_t op;
+}
+Requests[AVRX_TIMER_REQUESTS];
+
+static uint8_t ReqHead;
+
+/*****************************************************************************/
+uint8_t _TimerReqs;
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called with interrupts disabled.  Claims the timer queue if nobody
+	holds it.  Otherwise the queue is being walked by a task inside
+	AvrXStartTimer or by the timer handler, and this interrupt has broken
+	into it, so the request is left for the holder to carry out before it
+	lets the queue go.
+**/
+static uint8_t Claim(pTimerControlBlock p, uint16_t count, uint8_t op)
+{
+	uint8_t i;
+
+	if (_TimQLevel == 0)
+	{
+		_TimQLevel = 0xFF;
+		return 1;
+	}
+
+	if (_TimerReqs == AVRX_TIMER_REQUESTS)
+		AvrXHalt();
+
+	i = ReqHead + _TimerReqs;
+	if (i >= AVRX_TIMER_REQUESTS)
+		i -= AVRX_TIMER_REQUESTS;
+	Requests[i].tcb   = p;
+	Requests[i].count = count;
+	Requests[i].op    = op;
+	_TimerReqs++;
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called while holding the queue.  The semaphore is set here rather than
+	when the request is made so that a deferred cancel followed by a
+	restart of the same timer leaves it _PEND.
+**/
+static void Insert(pTimerControlBlock p, uint16_t count, uint8_t op)
+{
+	p->SObj.semaphore = op == REQ_MESSAGE ? TIMERMESSAGE_EV : AVRX_SEM_PEND;
+	_TimerInsert(p, count, 0);
+}
+
+/*****************************************************************************/
+static pTimerControlBlock Cancel(pTimerControlBlock p)
+{
+	AvrXIntSetObjectSemaphore((pSystemObject)p);
+	return _TimerRemove(p);
+}
+
+/*****************************************************************************/
+static void Start(pTimerControlBlock p, uint16_t count, uint8_t op)
+{
+	uint8_t mine;
+
+	uint8_t sreg = AvrXEnterCritical();
+	mine = Claim(p, count, op);
+	AvrXLeaveCritical(sreg);
+
+	if (mine)
+	{
+		Insert(p, count, op);
+		_TimerRelease();
+	}
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called by _TimerRelease (avrx_timequeue.S) while holding the queue.
+	Interrupts that arrive meanwhile add to the requests, so keep going
+	until there are none left.
+**/
+void _TimerDrain(void)
+{
+	pTimerControlBlock p;
+	uint16_t count;
+	uint8_t op;
+
+	for (;;)
+	{
+		uint8_t sreg = AvrXEnterCritical();
+		if (_TimerReqs == 0)
+		{
+			AvrXLeaveCritical(sreg);
+			return;
+		}
+		p     = Requests[ReqHead].tcb;
+		count = Requests[ReqHead].count;
+		op    = Requests[ReqHead].op;
+		if (++ReqHead == AVRX_TIMER_REQUESTS)
+			ReqHead = 0;
+		_TimerReqs--;
+		AvrXLeaveCritical(sreg);
+
+		if (op == REQ_CANCEL)
+			Cancel(p);
+		else
+			Insert(p, count, op);
+	}
+}
+
+/*****************************************************************************/
+void AvrXIntStartTimer(pTimerControlBlock p, uint16_t count)
+{
+	if (count == 0)
+		AvrXIntSetObjectSemaphore((pSystemObject)p);
+	else
+		Start(p, count, REQ_START);
+}
+
+/*****************************************************************************/
+void AvrXIntStartTimerMessage(pTimerMessageBlock p, uint16_t count, pMessageQueue q)
+{
+	p->queue = q;
+
+	if (count == 0)
+		AvrXIntSendMessage(q, &p->u.mcb);
+	else
+		Start(&p->u.tcb, count, REQ_MESSAGE);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	A free queue can be changed on the spot, with interrupts off, since
+	nothing is part way through walking it.  A kept cancel has removed
+	nothing yet, so returns 0 like a timer that was not running.
+**/
+pTimerControlBlock AvrXIntCancelTimer(pTimerControlBlock p)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	if (_TimQLevel == 0)
+		p = Cancel(p);
+	else
+	{
+		Claim(p, 0, REQ_CANCEL);
+		p = 0;
+	}
+	AvrXLeaveCritical(sreg);
+
+	return p;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
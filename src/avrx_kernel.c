@@ -33,6 +33,15 @@ pTimerControlBlock _TimerQueue;
 /*****************************************************************************/
 uint8_t _TimQLevel;
 
+/*****************************************************************************/
+pProcessID _TimerWoken;
+
+#ifdef AVRX_FASTINT
+/*****************************************************************************/
+uint8_t _KernelMasked;          // See avrx_fastint.S
+uint8_t _KernelBits;
+#endif
+
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
@@ -0,0 +1,166 @@
+/*
+ 	avrx_power.c - Idle sleep mode selection and idle hook
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#include "avrx.h"
+
+#ifdef AVRX_POWER
+
+extern struct AvrXKernelData AvrXKernelData;
+extern pTimerControlBlock _TimerQueue;
+
+void _AvrXIdle(void);
+void _PowerTick(void);
+
+/*
+	Sleep modes the part does not have fall back to the next lighter one.
+*/
+#ifndef SLEEP_MODE_ADC
+#  define SLEEP_MODE_ADC SLEEP_MODE_IDLE
+#endif
+#ifndef SLEEP_MODE_PWR_SAVE
+#  define SLEEP_MODE_PWR_SAVE SLEEP_MODE_ADC
+#endif
+
+static const uint8_t SleepModes[AVRX_SLEEP_MODES] PROGMEM =
+{
+	SLEEP_MODE_IDLE,
+	SLEEP_MODE_ADC,
+	SLEEP_MODE_PWR_SAVE,
+	SLEEP_MODE_PWR_DOWN
+};
+
+static uint8_t PowerHolds[AVRX_SLEEP_MODES];
+static uint8_t PowerMode;
+static void (*IdleHook)(void);
+
+AvrXPower AvrXPowerStats;
+
+/*****************************************************************************/
+void AvrXPowerHold(uint8_t mode)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	PowerHolds[mode]++;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+void AvrXPowerRelease(uint8_t mode)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	PowerHolds[mode]--;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+void AvrXSetIdleHook(void (*hook)(void))
+{
+	uint8_t sreg = AvrXEnterCritical();
+	IdleHook = hook;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+void AvrXPowerReset(void)
+{
+	uint8_t i;
+
+	uint8_t sreg = AvrXEnterCritical();
+	for (i = 0; i < AVRX_SLEEP_MODES; i++)
+	{
+		AvrXPowerStats.entries[i] = 0;
+		AvrXPowerStats.ticks[i] = 0;
+	}
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called from _IdleTask, on the kernel stack, each time the system has
+	nothing to run.  Runs the idle hook, then picks
+	the deepest mode allowed by the holds and the timer queue and sleeps
+	in it.  Any interrupt handler that uses the kernel never returns here;
+	_Epilog either switches to a task or restarts _IdleTask.
+**/
+void _AvrXIdle(void)
+{
+	void (*hook)(void) = IdleHook;
+	uint8_t mode;
+
+	if (hook != 0)
+	{
+		sei();
+		hook();
+	}
+	cli();
+
+	for (mode = 0; mode < AVRX_SLEEP_MODES - 1; mode++)
+		if (PowerHolds[mode] != 0)
+			break;
+
+	if (_TimerQueue != NOTIMER)		// The tick must keep running
+	{
+		if (_TimerQueue->count <= AVRX_SLEEP_MINTICKS)
+			mode = AVRX_SLEEP_IDLE;
+		else if (mode > AVRX_TICK_SLEEP)
+			mode = AVRX_TICK_SLEEP;
+	}
+
+	PowerMode = mode;
+	AvrXPowerStats.entries[mode]++;
+
+	set_sleep_mode(pgm_read_byte(&SleepModes[mode]));
+	sleep_enable();
+	sei();
+	sleep_cpu();					// The sei lets this go first
+	sleep_disable();
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called from AvrXTimerHandler, in kernel context, once per tick.  A tick
+	that arrives with no task running is charged to the last sleep mode.
+**/
+void _PowerTick(void)
+{
+	uint8_t sreg = AvrXEnterCritical();
+
+	if (AvrXKernelData.Running == NOPID)
+		AvrXPowerStats.ticks[PowerMode]++;
+
+	AvrXLeaveCritical(sreg);
+}
+
+#endif /* AVRX_POWER */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
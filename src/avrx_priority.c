@@ -1,5 +1,5 @@
 /*
- 	avrx_priority.c - Functions for getting and setting task priority
+ 	avrx_priority.c - Functions for getting task priority
 
 	Copyright (c)1998 - 2002 Larry Barello (larry@barello.net)
 	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
@@ -27,14 +27,6 @@
 
 extern struct AvrXKernelData AvrXKernelData;
 
-/*****************************************************************************/
-uint8_t AvrXChangePriority(pProcessID p, uint8_t priority)
-{
-	uint8_t t = p->priority;
-	p->priority = priority;
-	return t;
-}
-
 /*****************************************************************************/
 pProcessID AvrXSelf(void)
 {
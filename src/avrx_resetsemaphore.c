@@ -22,6 +22,7 @@
 
 */
 
+#define AVRX_NO_INLINE     // Defines the out-of-line versions
 #include "avrx.h"
 
 /*****************************************************************************/
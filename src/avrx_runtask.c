@@ -30,6 +30,36 @@ void AvrXRunTask(TaskControlBlock *pTCB)
 	AvrXResume(pPID);
 }
 
+/*****************************************************************************/
+void _AvrXResumeList(pProcessID);
+
+/**
+	Notes
+
+	Initialises each task in 'table' (n TCB pointers in flash) and links
+	the PIDs into a list sorted by priority, equals kept in table order.
+	_AvrXResumeList then merges the list into the run queue in one pass
+	and leaves the kernel once, rather than once per task.
+**/
+void AvrXRunTasks(TaskControlBlock * const *table, uint8_t n)
+{
+	pProcessID list = NOPID;
+
+	while (n--)
+	{
+		pProcessID pid = AvrXInitTask((TaskControlBlock *)pgm_read_word(table++));
+		pProcessID *p = &list;
+
+		pid->flags = 0;				// Resumed
+		while (*p != NOPID && (*p)->priority <= pid->priority)
+			p = &(*p)->next;
+		pid->next = *p;
+		*p = pid;
+	}
+	if (list != NOPID)
+		_AvrXResumeList(list);
+}
+
 /*****************************************************************************/
 /*****************************************************************************/
 /*****************************************************************************/
@@ -0,0 +1,115 @@
+/*
+ 	avrx_seqlock.c - Sequence locks for latest value data
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <string.h>
+
+#include "avrx.h"
+
+/* Keeps the compiler from moving the copy across the sequence updates */
+#define Fence() asm volatile ("" ::: "memory")
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Only readers make the semaphore non _PEND, and they queue on it from
+	task context, so it cannot change under the writer's test:
+	the interrupt handler writer runs to the end, and the task writer
+	holds the scheduler lock.  With nobody waiting no kernel call is made.
+**/
+static void Write(pSeqLock pLock, void *data, const void *value, uint8_t size)
+{
+	pLock->seq++;
+	Fence();
+	memcpy(data, value, size);
+	Fence();
+	pLock->seq++;
+}
+
+/*****************************************************************************/
+void AvrXIntSeqWrite(pSeqLock pLock, void *data, const void *value, uint8_t size)
+{
+	Write(pLock, data, value, size);
+	if (pLock->sem != AVRX_SEM_PEND)
+		AvrXIntBroadcastSemaphore(&pLock->sem);
+}
+
+/*****************************************************************************/
+void AvrXSeqWrite(pSeqLock pLock, void *data, const void *value, uint8_t size)
+{
+	AvrXSchedLock();
+	Write(pLock, data, value, size);
+	AvrXSchedUnlock();
+	if (pLock->sem != AVRX_SEM_PEND)
+		AvrXBroadcastSemaphore(&pLock->sem);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The reader is a task, so it never runs in the middle of a write: the
+	writer is either an interrupt handler or holds the scheduler lock.  An
+	odd sequence can only be seen if that rule is broken, and is waited
+	out rather than copied.
+**/
+uint8_t AvrXSeqRead(pSeqLock pLock, void *value, const void *data, uint8_t size)
+{
+	uint8_t seq;
+
+	do
+	{
+		while ((seq = pLock->seq) & 1)
+			;
+		Fence();
+		memcpy(value, data, size);
+		Fence();
+	}
+	while (pLock->seq != seq);
+
+	return seq;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	As in AvrXBarrierWait, interrupts stay disabled from the test of the
+	sequence to this task being queued on the semaphore, so a write in
+	between cannot be missed.
+**/
+void AvrXSeqWait(pSeqLock pLock, uint8_t seq)
+{
+	BeginCritical();
+	if (pLock->seq == seq)
+	{
+		AvrXWaitSemaphore(&pLock->sem);
+		return;
+	}
+	EndCritical();
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
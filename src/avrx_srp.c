@@ -0,0 +1,110 @@
+/*
+ 	avrx_srp.c - Stack Resource Policy jobs
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+
+/*****************************************************************************/
+void (*_SrpTable[AVRX_SRP_LEVELS])(void);
+
+/*****************************************************************************/
+uint8_t _SrpReady;
+
+/*****************************************************************************/
+uint8_t _SrpCeiling = AVRX_SRP_LEVELS;
+
+/*****************************************************************************/
+void AvrXSrpRegister(uint8_t level, void (*job)(void))
+{
+	_SrpTable[level] = job;
+}
+
+/*****************************************************************************/
+void AvrXIntSrpPost(uint8_t level)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	_SrpReady |= _BV(level);
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+uint8_t AvrXSrpLock(uint8_t ceiling)
+{
+	uint8_t t;
+
+	uint8_t sreg = AvrXEnterCritical();
+	t = _SrpCeiling;
+	if (ceiling < t)
+		_SrpCeiling = ceiling;
+	AvrXLeaveCritical(sreg);
+
+	return t;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Runs, most urgent first, every ready job whose level is below the
+	current ceiling.  While a job runs the ceiling is its own level, so
+	only more urgent jobs can preempt it; they do so by nesting another
+	call to this function on top of it, exactly like nested interrupts.
+	All jobs therefore share the kernel stack.
+
+	Must be called in kernel context.  Jobs run with interrupts enabled.
+**/
+void AvrXSrpDispatch(void)
+{
+	uint8_t ready, level, saved;
+
+	uint8_t sreg = AvrXEnterCritical();
+
+	for (;;)
+	{
+		ready = _SrpReady & (uint8_t)(_BV(_SrpCeiling) - 1);
+		if (ready == 0)
+			break;
+
+		for (level = 0; !(ready & 1); level++)
+			ready >>= 1;
+
+		_SrpReady &= ~_BV(level);
+		saved = _SrpCeiling;
+		_SrpCeiling = level;
+
+		EndCritical();
+		_SrpTable[level]();
+		BeginCritical();
+
+		_SrpCeiling = saved;
+	}
+
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,166 @@
+/*
+ 	avrx_stats.c - Semaphore and message queue statistics
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+
+#ifdef AVRX_STATS
+
+/*****************************************************************************/
+static pAvrXStats StatsList;
+
+/*****************************************************************************/
+static pAvrXStats Find(void *object)
+{
+	pAvrXStats p;
+
+	for (p = StatsList; p; p = p->next)
+		if (p->object == object)
+			break;
+
+	return p;
+}
+
+/*****************************************************************************/
+static uint8_t Length(void *head)
+{
+	pSystemObject p;
+	uint8_t n = 0;
+
+	for (p = head; p && n != 0xFF; p = p->next)
+		n++;
+
+	return n;
+}
+
+/*****************************************************************************/
+void AvrXStatsRegister(pAvrXStats p, void *object, uint8_t kind)
+{
+	p->object = object;
+	p->kind   = kind;
+	AvrXStatsReset(p);
+
+	uint8_t sreg = AvrXEnterCritical();
+	p->next   = StatsList;
+	StatsList = p;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+pAvrXStats AvrXStatsFirst(void)
+{
+	return StatsList;
+}
+
+/*****************************************************************************/
+void AvrXStatsReset(pAvrXStats p)
+{
+	uint8_t sreg = AvrXEnterCritical();
+	p->maxwaiters = 0;
+	p->maxdepth   = 0;
+	p->acquires   = 0;
+	p->contended  = 0;
+	AvrXLeaveCritical(sreg);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The hooks below are called from the kernel with interrupts disabled.
+
+	Called by AvrXWaitSemaphore, after the caller has either taken the
+	semaphore or been queued on it.  Waits on a message queue's task
+	semaphore are made by AvrXWaitMessage, which counts the receive
+	itself, so only the waiter count is taken for those.
+**/
+void _StatsWait(pMutex pSem, uint8_t blocked)
+{
+	pAvrXStats p = Find(pSem);
+	uint8_t n;
+
+	if (!p)
+		return;
+
+	if (p->kind == AVRX_STATS_MUTEX)
+	{
+		p->acquires++;
+		if (blocked)
+			p->contended++;
+	}
+
+	if (blocked)
+	{
+		n = Length(*pSem);
+		if (n > p->maxwaiters)
+			p->maxwaiters = n;
+	}
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called by AvrXIntSendMessage once the message is on the queue.
+**/
+void _StatsSend(pMessageQueue pQueue)
+{
+	pAvrXStats p = Find(&pQueue->pid);
+	uint8_t n;
+
+	if (!p)
+		return;
+
+	n = Length(pQueue->message);
+	if (n > p->maxdepth)
+		p->maxdepth = n;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called by AvrXRecvMessage and AvrXWaitMessage with the message taken
+	off the queue, or 0 if it was empty.
+**/
+void _StatsRecv(pMessageQueue pQueue, pMessageControlBlock pMsg)
+{
+	pAvrXStats p = Find(&pQueue->pid);
+
+	if (!p)
+		return;
+
+	if (pMsg)
+		p->acquires++;
+	else
+		p->contended++;
+}
+
+#endif /* AVRX_STATS */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -22,34 +22,60 @@
 
 */
 
+#include <string.h>
+
 #include "avrx.h"
 
-#define PUSH_BYTE(b)	do{*pStack-- = (uint8_t)(b);} while(0)
+void _AvrXInitProcess(pProcessID, uint8_t *, void(*)(void), uint8_t);
 							   
 #define PUSH_WORD(w)	do{uint16_t ww = (uint16_t)(w); \
 	    		           *pStack-- = ((ww)&0xFF);     \
 	                       *pStack-- = (((ww)>>8)&0xFF);} while(0)
 
-pProcessID AvrXInitTask(TaskControlBlock *pTCB)
+/*****************************************************************************/
+/**
+	Notes
+
+	Builds the initial context for 'pTask' on the stack at 'pStack' (top
+	address) and initialises the PID, leaving it suspended.  Shared by
+	AvrXInitTask and tasks whose stack and PID are assigned at run time.
+**/
+void _AvrXInitProcess(pProcessID pid, uint8_t *pStack, void(*pTask)(void), uint8_t priority)
 {
-	pProcessID pid;
-	uint8_t *pStack;
-	void(*pTask)(void);
-
-	pStack   = (uint8_t *)    pgm_read_word(&pTCB->r_stack);
-	pTask    = (void(*)(void))pgm_read_word(&pTCB->start);
-
 	PUSH_WORD((uint16_t)pTask);
 
 	//set R0-R31 and SREG to 0
-	for (uint8_t i=0; i < 33; i++)
-		PUSH_BYTE(0);
+	pStack -= 33;
+	memset(pStack + 1, 0, 33);
 
-	pid = (pProcessID) pgm_read_word(&pTCB->pid);
 	pid->ContextPointer = (void *)pStack;
-	pid->priority       = pgm_read_byte(&pTCB->priority);
+	pid->priority       = priority;
 	pid->flags          = AVRX_PID_Suspend | AVRX_PID_Suspended;
 	pid->next           = 0;
+#ifdef AVRX_DLIST
+	pid->prev           = 0;
+#endif
+#ifdef AVRX_TIMESLICE
+	pid->quantum        = 0;
+	pid->slice          = 0;
+#endif
+#ifdef AVRX_EDF
+	pid->period         = 0;
+	pid->misses         = 0;
+#endif
+}
+
+/*****************************************************************************/
+pProcessID AvrXInitTask(TaskControlBlock *pTCB)
+{
+	pProcessID pid;
+
+	pid = (pProcessID) pgm_read_word(&pTCB->pid);
+
+	_AvrXInitProcess(pid,
+	                 (uint8_t *)    pgm_read_word(&pTCB->r_stack),
+	                 (void(*)(void))pgm_read_word(&pTCB->start),
+	                 pgm_read_byte(&pTCB->priority));
 
 	return pid;
 }
@@ -0,0 +1,162 @@
+/*
+ 	avrx_taskpool.c - Pool of reusable task slots
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include "avrx.h"
+
+extern struct AvrXKernelData AvrXKernelData;
+
+void _AvrXInitProcess(pProcessID, uint8_t *, void(*)(void), uint8_t);
+
+/* Offsets of R24/R25 above the saved context pointer (see avrx.inc) */
+#define CTX_R24		26
+#define CTX_R25		27
+
+/*****************************************************************************/
+void AvrXPoolInit(pTaskPool pPool)
+{
+	for (uint8_t i = 0; i < pPool->nslots; i++)
+	{
+		pPool->slots[i].pid.flags = AVRX_PID_Idle;
+		pPool->slots[i].done      = AVRX_SEM_PEND;
+	}
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	A slot is free when its PID has the Idle flag, which AvrXTerminate
+	sets from inside the kernel.  A task exiting through AvrXPoolExit is
+	therefore never seen as free until it has been switched out for the
+	last time, so its stack cannot be reused under it.
+
+	The slot is claimed by clearing the Idle flag inside the same critical
+	section that found it.  The entry point is called with 'arg' in R24:R25
+	and returns into AvrXPoolExit.
+**/
+pPoolTask AvrXSpawn(pTaskPool pPool, AvrXPoolFunc func, void *arg, uint8_t priority)
+{
+	pPoolTask t = 0;
+	uint8_t *pStack;
+	uint8_t i;
+
+	BeginCritical();
+	for (i = 0; i < pPool->nslots; i++)
+	{
+		if (pPool->slots[i].pid.flags & AVRX_PID_Idle)
+		{
+			t = &pPool->slots[i];
+			t->pid.flags = AVRX_PID_Suspend | AVRX_PID_Suspended;
+			break;
+		}
+	}
+	EndCritical();
+
+	if (t == 0)
+		return 0;
+
+	t->done = AVRX_SEM_PEND;
+
+	pStack = pPool->stacks + (uint16_t)(i + 1) * pPool->stacksz - 1;
+	*pStack-- = (uint16_t)AvrXPoolExit & 0xFF;
+	*pStack-- = (uint16_t)AvrXPoolExit >> 8;
+
+	_AvrXInitProcess(&t->pid, pStack, (void(*)(void))func, priority);
+
+	pStack = (uint8_t *)t->pid.ContextPointer;
+	pStack[CTX_R24] = (uint16_t)arg & 0xFF;
+	pStack[CTX_R25] = (uint16_t)arg >> 8;
+
+	AvrXResume(&t->pid);
+
+	return t;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The completion semaphore is signalled before the task terminates
+	itself.  If that wakes a higher priority joiner the joiner runs first,
+	but the slot still looks busy until AvrXTerminate completes.
+**/
+void AvrXPoolExit(void)
+{
+	pPoolTask t = (pPoolTask)AvrXSelf();
+
+	AvrXSetSemaphore(&t->done);
+	AvrXTerminate(&t->pid);
+	while(1);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Without AVRX_DLIST the kernel cannot unlink a task blocked on a
+	semaphore or message queue, so such a task is not killed (its slot
+	would be reused while it is still queued).  It can be killed once it
+	is ready or suspended.
+
+	The scheduler is locked from the check to the terminate, so the target
+	cannot run and block in between; interrupt handlers can only make it
+	ready.  The completion semaphore is set once the task is dead, so a
+	joiner never finds the slot still busy.
+**/
+uint8_t AvrXPoolKill(pPoolTask t)
+{
+	pProcessID p = &t->pid;
+	uint8_t live;
+
+	if (p == AvrXSelf())
+		AvrXPoolExit();
+
+	AvrXSchedLock();
+	BeginCritical();
+	live = !(p->flags & AVRX_PID_Idle);
+#ifndef AVRX_DLIST
+	if (live && !(p->flags & AVRX_PID_Suspended))
+	{
+		pProcessID q = AvrXKernelData.RunQueue;
+
+		while (q != NOPID && q != p)
+			q = q->next;
+		live = (q != NOPID);
+	}
+#endif
+	EndCritical();
+
+	if (live)
+	{
+		AvrXTerminate(p);
+		AvrXSetSemaphore(&t->done);
+	}
+	AvrXSchedUnlock();
+
+	return live;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -25,6 +25,7 @@
 #include <avr/interrupt.h>
 #include <avr/io.h>
 
+#define AVRX_NO_INLINE     // Defines the out-of-line versions
 #include <avrx.h>
 
 /*****************************************************************************/
@@ -35,8 +36,7 @@ Mutex AvrXTestSemaphore(pMutex mtx)
 	/* Enter critical region, saving the SREG on the way in and turning off
 	   interrupts. 
 	*/
-	uint8_t sreg = SREG;
-	cli();
+	uint8_t sreg = AvrXEnterCritical();
 	
 	retval = *mtx;
 	
@@ -53,7 +53,7 @@ Mutex AvrXTestSemaphore(pMutex mtx)
 	   I flag (previously disabled) to re-enable interrupts.  If in KERNEL
 	   space then the I flag was already disabled and will remain disabled.
 	*/
-	SREG = sreg;
+	AvrXLeaveCritical(sreg);
 	return retval;
 }
 		
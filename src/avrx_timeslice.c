@@ -0,0 +1,88 @@
+/*
+ 	avrx_timeslice.c - Time slicing among equal priority tasks
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+
+#ifdef AVRX_TIMESLICE
+
+extern struct AvrXKernelData AvrXKernelData;
+
+void _TimeSliceTick(void);
+
+/*****************************************************************************/
+uint8_t AvrXSetTimeSlice(pProcessID p, uint8_t quantum)
+{
+	uint8_t t;
+
+	BeginCritical();
+	t = p->quantum;
+	p->quantum = quantum;
+	p->slice   = quantum;
+	EndCritical();
+
+	return t;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Called from AvrXTimerHandler, in kernel context, once per tick.
+
+	Only the task that was running when the tick arrived is charged, and
+	only if it is still at the top of the run queue (i.e. it has not
+	blocked and nothing has preempted it).  When its slice runs out it is
+	given a new one and, if the next task on the run queue has the same
+	priority, moved behind its peers with AvrXIntReschedule().  The task
+	switch itself happens in _Epilog on the way out of the interrupt.
+**/
+void _TimeSliceTick(void)
+{
+	pProcessID p, n;
+
+	uint8_t sreg = AvrXEnterCritical();
+
+	p = AvrXKernelData.Running;
+	if (p != NOPID && p == AvrXKernelData.RunQueue && p->quantum != 0)
+	{
+		if (--p->slice == 0)
+		{
+			p->slice = p->quantum;
+			n = p->next;
+			if (n != NOPID && n->priority == p->priority)
+				AvrXIntReschedule();
+		}
+	}
+
+	AvrXLeaveCritical(sreg);
+}
+
+#endif /* AVRX_TIMESLICE */
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,81 @@
+/*
+ Barrier Test
+
+ Checks broadcast wake and barriers.
+
+ The following API covered:
+    AvrXBarrierWait
+    AvrXBroadcastSemaphore  // Indirectly covered
+    AvrXIntBroadcastSemaphore
+
+ Three workers at different priorities step through rounds in lock step.
+ Each bumps its own round counter and then waits at the barrier; after the
+ barrier no worker may be behind, and none more than one round ahead (the
+ more urgent ones start the next round first).  Exactly one worker is told
+ it was last in each round, and it prints "1".
+ */
+
+#include "avrx.h"
+#include "hardware.h"
+
+AVRX_BARRIER(Round, 3);
+
+volatile uint16_t Count[3];
+volatile uint16_t Last;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void Worker(uint8_t n)
+{
+    uint8_t i;
+
+    while(1)
+    {
+        Count[n]++;
+        if (AvrXBarrierWait(&Round))
+        {
+            if (++Last != Count[n])
+                {debug_puts("HALT@last");AvrXHalt();}
+            debug_puts("1");
+        }
+        for (i = 0; i < 3; i++)
+            if ((uint16_t)(Count[i] - Count[n]) > 1)
+                {debug_puts("HALT@step");AvrXHalt();}
+    }
+}
+
+AVRX_TASKDEF(worker1, 20, 2)
+{
+    Worker(0);
+}
+
+AVRX_TASKDEF(worker2, 20, 3)
+{
+    Worker(1);
+}
+
+AVRX_TASKDEF(worker3, 20, 4)
+{
+    Worker(2);
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXRunTask(TCB(worker1));
+    AvrXRunTask(TCB(worker2));
+    AvrXRunTask(TCB(worker3));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,139 @@
+/*
+ Call Test
+
+ Checks, and measures, client/server round trips.
+
+ The following API covered:
+    AvrXCall
+    AvrXReplyAndWait
+    AvrXSendMessage         // For comparison
+    AvrXWaitMessageAck
+    AvrXAckMessage
+    AvrXWaitMessage
+
+ A client sends a value to a more urgent server, which doubles it and
+ replies.  The client checks every answer.  Every REPORT ticks a monitor
+ prints the number of round trips completed, alternating between the
+ separate send/ack calls ("S") and AvrXCall/AvrXReplyAndWait ("C").  The
+ "C" counts should be consistently higher.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define REPORT  100
+
+typedef struct
+{
+    MessageControlBlock mcb;
+    uint16_t value;
+}
+Request;
+
+AVRX_MESSAGEQ(Server);
+
+Request Req;
+
+TimerControlBlock ReportTimer;
+
+volatile uint8_t UseCall;
+volatile uint16_t Trips;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_TASKDEF(server, 20, 2)
+{
+    pMessageControlBlock m = NOMESSAGE;
+
+    while(1)
+    {
+        if (UseCall)
+            m = AvrXReplyAndWait(&Server, m);
+        else
+        {
+            if (m != NOMESSAGE)
+                AvrXAckMessage(m);
+            m = AvrXWaitMessage(&Server);
+        }
+        ((Request *)m)->value *= 2;
+    }
+}
+
+AVRX_TASKDEF(client, 20, 3)
+{
+    uint16_t n = 1;
+
+    while(1)
+    {
+        Req.value = n;
+        if (UseCall)
+            AvrXCall(&Server, &Req.mcb);
+        else
+        {
+            AvrXSendMessage(&Server, &Req.mcb);
+            AvrXWaitMessageAck(&Req.mcb);
+        }
+        if (Req.value != 2 * n)
+            {debug_puts("HALT@reply");AvrXHalt();}
+        n++;
+        Trips++;
+    }
+}
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    while(1)
+    {
+        Trips = 0;
+        AvrXDelay(&ReportTimer, REPORT);
+
+        debug_puts(UseCall ? "C " : "S ");
+        debug_puthex(Trips);
+        debug_puts("\n");
+        UseCall = !UseCall;
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(server));
+    AvrXRunTask(TCB(client));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,118 @@
+/*
+ C++ Interface Test
+
+ Runs a producer and a consumer declared with the avrx.hpp wrappers.
+
+ The following API covered:
+    avrx::Task, avrx::TaskTable
+    avrx::Semaphore, avrx::Lock
+    avrx::Timer
+    avrx::Message, avrx::MessageQueue
+    avrx::Critical
+
+ The producer counts, sends each value in a message and waits for the
+ ack, sleeping a tick in between.  The consumer checks the values arrive
+ in order and keeps a running total under a semaphore lock.  The tasks
+ are started with TaskTable::Start(), from their link time contexts.
+ Every REPORT messages the consumer prints "1".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.hpp"
+#include "hardware.h"
+
+#define REPORT  100
+
+struct Reading : avrx::Message
+{
+    uint16_t value;
+};
+
+avrx::MessageQueue<Reading> Readings;
+avrx::Semaphore TotalLock;
+avrx::Timer Tick;
+
+uint16_t Total;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+void producer(void) CTASK;
+void consumer(void) CTASK;
+
+typedef avrx::Task<producer, 20 + MINCONTEXT, 2> Producer;
+typedef avrx::Task<consumer, 20 + MINCONTEXT, 1> Consumer;
+
+void producer(void)
+{
+    Reading r;
+
+    for (uint16_t n = 1; ; n++)
+    {
+        r.value = n;
+        Readings.Send(r);
+        r.WaitAck();
+        Tick.Delay(1);
+    }
+}
+
+void consumer(void)
+{
+    uint16_t last = 0;
+
+    TotalLock.Set();
+    while(1)
+    {
+        Reading *r = Readings.Wait();
+
+        if (r->value != last + 1)
+            {debug_puts("HALT@order");AvrXHalt();}
+        last = r->value;
+        {
+            avrx::Lock<avrx::Semaphore> l(TotalLock);
+            Total += last;
+        }
+        r->Ack();
+
+        {
+            avrx::Critical c;
+            if (TotalLock.Test() != AVRX_SEM_DONE)
+                {debug_puts("HALT@lock");AvrXHalt();}
+            TotalLock.Set();
+        }
+        if (last % REPORT == 0)
+            debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    avrx::TaskTable<Producer, Consumer>::Start();
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,146 @@
+/*
+ EDF Test
+
+ Exercises earliest deadline first scheduling.  The library and this test
+ must both be built with -DAVRX_EDF.
+
+ The following API covered:
+    AvrXEdfSetPeriod
+    AvrXEdfWaitPeriod
+    AvrXEdfNow
+    AvrXEdfMisses
+    AvrXTimerHandler        // Advances the deadline clock
+
+ Three periodic tasks of the same priority are released together and each
+ records its letter when it runs.  They are started A, B, C but must run
+ in deadline order, B (10), C (20), A (30), on every period.  A fourth task
+ with a two tick deadline spins for four ticks, so it must be charged with
+ missed deadlines while the others are not.  A higher priority monitor
+ checks the results and prints "1" each time they pass.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define PERIOD  50
+
+TimerControlBlock TimerA, TimerB, TimerC, TimerLate, MonitorTimer;
+
+volatile char Trace[6];
+volatile uint8_t TraceN;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+void Job(char c)
+{
+    if (TraceN < sizeof(Trace))
+        Trace[TraceN++] = c;
+}
+
+AVRX_TASKDEF(taskA, 20, 5)
+{
+    while(1)
+    {
+        Job('A');
+        AvrXEdfWaitPeriod(&TimerA);
+    }
+}
+
+AVRX_TASKDEF(taskB, 20, 5)
+{
+    while(1)
+    {
+        Job('B');
+        AvrXEdfWaitPeriod(&TimerB);
+    }
+}
+
+AVRX_TASKDEF(taskC, 20, 5)
+{
+    while(1)
+    {
+        Job('C');
+        AvrXEdfWaitPeriod(&TimerC);
+    }
+}
+
+AVRX_TASKDEF(late, 20, 5)
+{
+    uint16_t t;
+
+    while(1)
+    {
+        t = AvrXEdfNow();
+        while (AvrXEdfNow() - t < 4)
+            ;
+        AvrXEdfWaitPeriod(&TimerLate);
+    }
+}
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    static const char expect[] = "BCABCA";
+    uint8_t i;
+
+    AvrXDelay(&MonitorTimer, 2 * PERIOD + 10);
+
+    for (i = 0; i < sizeof(Trace); i++)
+        if (Trace[i] != expect[i])
+            {debug_puts("HALT@order");AvrXHalt();}
+
+    if (AvrXEdfMisses(PID(taskA)) || AvrXEdfMisses(PID(taskB)) ||
+        AvrXEdfMisses(PID(taskC)))
+        {debug_puts("HALT@miss");AvrXHalt();}
+
+    if (AvrXEdfMisses(PID(late)) == 0)
+        {debug_puts("HALT@late");AvrXHalt();}
+
+    while(1)
+    {
+        debug_puts("1");
+        AvrXDelay(&MonitorTimer, PERIOD);
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(taskA));
+    AvrXRunTask(TCB(taskB));
+    AvrXRunTask(TCB(taskC));
+    AvrXRunTask(TCB(late));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXEdfSetPeriod(PID(taskA), PERIOD, 30);   // Periods are cleared by
+    AvrXEdfSetPeriod(PID(taskB), PERIOD, 10);   // AvrXRunTask, so set them
+    AvrXEdfSetPeriod(PID(taskC), PERIOD, 20);   // after starting the tasks
+    AvrXEdfSetPeriod(PID(late), 2 * PERIOD, 2);
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,179 @@
+/*
+ Fast Interrupt Test
+
+ Checks that a fast interrupt is never held off for long by the kernel.
+ Needs the library built with AVRX_FASTINT, AVRX_KMASK_REG=TIMSK and
+ AVRX_KMASK_BITS=0x01 (the Timer 0 overflow).
+
+ The following API covered:
+    AvrXEnterCritical
+    AvrXLeaveCritical
+    AvrXLeaveKernel     // With the tick pending
+
+ Timer 2 runs at the CPU clock and its overflow handler is an ordinary
+ ISR() that never calls AvrX.  It reads TCNT2 on entry, which is the time
+ since the overflow plus a fixed prologue, and keeps the largest value.
+ Meanwhile a crowd of tasks keeps the kernel busy with semaphores, run
+ queue walks and context switches, on top of the 1 kHz system tick.  Every
+ REPORT ticks the monitor prints the worst latency seen and checks it
+ against LIMIT.
+
+ Every PEND ticks the tick handler makes the next tick overflow at once
+ and waits for it, with the kernel sources still masked, so _Epilog hands
+ over to a task with the tick pending.  It must then be taken in the
+ restore window without disturbing the task's frame; the spinners keep
+ values live across each kernel entry and check them.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define REPORT  1000
+#define LIMIT   120             // Cycles, including the ISR prologue
+#define PEND    7               // Ticks between pended ticks
+
+AVRX_MUTEX(Ping);
+AVRX_MUTEX(Pong);
+
+TimerControlBlock ReportTimer;
+
+volatile uint8_t Worst;
+uint8_t Ticks;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    if (++Ticks == PEND)
+    {
+        Ticks = 0;
+        TCNT0 = 0xFF;                   // Overflow again at once, and leave
+        while (!(TIFR & _BV(TOV0)))     // it pending for _Epilog to unmask
+            ;
+    }
+    else
+        TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+ISR(TIMER2_OVF_vect)
+{
+    uint8_t t = TCNT2;
+
+    if (t > Worst)
+        Worst = t;
+}
+
+AVRX_TASKDEF(pinger, 30, 2)
+{
+    uint8_t s;
+
+    while(1)
+    {
+        AvrXSetSemaphore(&Ping);
+        AvrXWaitSemaphore(&Pong);
+
+        s = AvrXEnterCritical();        // Kernel style section
+        AvrXLeaveCritical(s);
+    }
+}
+
+AVRX_TASKDEF(ponger, 30, 2)
+{
+    while(1)
+    {
+        AvrXWaitSemaphore(&Ping);
+        AvrXSetSemaphore(&Pong);
+    }
+}
+
+void Spinner(uint8_t k)
+{
+    uint16_t a = k, b = ~a;     // Live across every kernel entry
+
+    while(1)
+    {
+        AvrXYield();            // Walks the run queue each time
+        a += k;
+        b -= k;
+        if ((uint16_t)(a + b) != 0xFFFF)
+            {debug_puts("HALT@frame");AvrXHalt();}
+    }
+}
+
+AVRX_TASKDEF(spin1, 30, 2)
+{
+    Spinner(1);
+}
+
+AVRX_TASKDEF(spin2, 30, 2)
+{
+    Spinner(3);
+}
+
+AVRX_TASKDEF(spin3, 30, 2)
+{
+    Spinner(5);
+}
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    uint8_t w;
+
+    while(1)
+    {
+        AvrXDelay(&ReportTimer, REPORT);
+
+        cli();
+        w = Worst;
+        Worst = 0;
+        sei();
+
+        debug_puthex(w);
+        debug_puts("\n");
+        if (w > LIMIT)
+            {debug_puts("HALT@latency");AvrXHalt();}
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TCCR2 = _BV(CS20);    // Timer 2 overflows every 256 cycles
+	TIMSK = _BV(TOIE0) | _BV(TOIE2);
+
+    AvrXRunTask(TCB(pinger));
+    AvrXRunTask(TCB(ponger));
+    AvrXRunTask(TCB(spin1));
+    AvrXRunTask(TCB(spin2));
+    AvrXRunTask(TCB(spin3));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,134 @@
+/*
+ Clock Governor Test
+
+ Checks that the clock is slowed when the system is idle and put back to
+ full speed under load or on request.  Needs the library and the test
+ built with AVRX_GOVERNOR for a part with CLKPR (make MCU=atmega88).
+
+ The following API covered:
+    AvrXGovernorInit
+    AvrXClockShift
+    AvrXClockHold
+    AvrXClockRelease
+    AvrXTickReload
+
+ The monitor first sleeps for several windows with nothing else to run,
+ after which the clock must be at its slowest.  A hold must bring it
+ straight back to full speed.  It then lets a low priority task spin for
+ two windows, after which the clock must be at full speed again.  The
+ tick period (32 timer counts) divides evenly at every step.  Each round
+ prints "1".
+
+ Timer 1 counts the system clock / 8 throughout, so it slows down with
+ the clock.  MEASURE ticks are timed with it at full speed at the start
+ and again at the slowest clock; scaled back up by the clock division the
+ two must agree to within 1%, or the ticks have changed length.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define MEASURE 64              // Ticks timed against Timer 1
+
+TimerControlBlock Wait;
+
+uint16_t FullSpeed;             // Timer 1 counts for MEASURE ticks
+
+AVRX_MUTEX(Go);
+
+volatile uint8_t Spin;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = AvrXTickReload;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_TASKDEF(spinner, 20, 2)
+{
+    while(1)
+    {
+        AvrXWaitSemaphore(&Go);
+        Spin = 1;
+        while (Spin)
+            ;
+    }
+}
+
+uint16_t Measure(void)
+{
+    uint16_t start;
+
+    AvrXDelay(&Wait, 1);            // Line up on a tick
+    start = TCNT1;
+    AvrXDelay(&Wait, MEASURE);
+    return TCNT1 - start;
+}
+
+AVRX_TASKDEF(monitor, 30, 1)
+{
+    uint16_t t;
+
+    AvrXClockHold();
+    FullSpeed = Measure();
+    AvrXClockRelease();
+
+    while(1)
+    {
+        AvrXDelay(&Wait, 5 * AVRX_GOV_WINDOW);
+        if (AvrXClockShift() != AVRX_GOV_MAXSHIFT)
+            {debug_puts("HALT@slow");AvrXHalt();}
+
+        t = Measure() << AVRX_GOV_MAXSHIFT;
+        if (t < FullSpeed - FullSpeed / 100 || t > FullSpeed + FullSpeed / 100)
+            {debug_puts("HALT@length");AvrXHalt();}
+
+        AvrXClockHold();
+        if (AvrXClockShift() != 0)
+            {debug_puts("HALT@hold");AvrXHalt();}
+        AvrXClockRelease();
+
+        AvrXDelay(&Wait, 2 * AVRX_GOV_WINDOW);  // Slow again meanwhile
+        AvrXSetSemaphore(&Go);
+        AvrXDelay(&Wait, 2 * AVRX_GOV_WINDOW);
+        Spin = 0;
+        if (AvrXClockShift() != 0)
+            {debug_puts("HALT@fast");AvrXHalt();}
+
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXGovernorInit(TCNT0_INIT);
+
+	SMCR = _BV(SE);       // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0B = TMC8_CK256;
+	TIMSK0 = _BV(TOIE0);   // Enable Timer overflow interrupt
+	TCCR1B = _BV(CS11);   // Timer 1 free running at clock / 8
+
+    AvrXRunTask(TCB(spinner));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,134 @@
+/*
+ Interrupt Timer Test
+
+ An interrupt handler restarts a receive timeout on every "byte".
+
+ The following API covered:
+    AvrXIntStartTimer
+    AvrXIntCancelTimer
+
+ Timer 2 stands in for a UART: its overflow interrupt delivers bursts of
+ BURST bytes, a few per tick, separated by equally long quiet spells.  On
+ each byte the handler cancels the timeout and starts it again, so it only
+ runs out GAP ticks after the last byte of a burst.  Timer 2 overflows
+ often enough to land inside the tick handler now and then, which makes
+ the requests wait for the timer queue to be released.
+
+ The receiver task counts frames and checks a frame never ends less than
+ GAP ticks after a byte.  Every REPORT ticks the monitor prints the number
+ of frames seen, which should be about REPORT / (2 * BURST ticks).
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define GAP     3
+#define BURST   64              // Timer 2 overflows
+#define REPORT  1000
+
+TimerControlBlock Timeout, ReportTimer;
+
+volatile uint16_t Ticks;
+volatile uint16_t LastByte;
+volatile uint16_t Frames;
+uint8_t Phase;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    Ticks++;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_SIGINT(TIMER2_OVF_vect)
+{
+    AvrXEnterKernel();
+    if (++Phase & BURST)
+    {
+        LastByte = Ticks;
+        AvrXIntCancelTimer(&Timeout);
+        AvrXIntStartTimer(&Timeout, GAP);
+    }
+    AvrXLeaveKernel();
+}
+
+uint16_t Now(void)
+{
+    uint16_t t;
+
+    BeginCritical();
+    t = Ticks;
+    EndCritical();
+    return t;
+}
+
+AVRX_TASKDEF(receiver, 20, 2)
+{
+    uint16_t d;
+
+    while(1)
+    {
+        AvrXWaitTimer(&Timeout);    // Also woken by each cancel
+
+        BeginCritical();
+        d = Ticks - LastByte;
+        EndCritical();
+
+        if (d >= GAP)
+            Frames++;
+        else if (AvrXTestTimer(&Timeout) == AVRX_SEM_DONE)
+            {debug_puts("HALT@gap");AvrXHalt();}
+    }
+}
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    while(1)
+    {
+        Frames = 0;
+        AvrXDelay(&ReportTimer, REPORT);
+
+        debug_puthex(Frames);
+        debug_puts("\n");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TCCR2 = _BV(CS21);    // Timer 2 overflows every 2048 cycles
+	TIMSK = _BV(TOIE0) | _BV(TOIE2);
+
+    AvrXRunTask(TCB(receiver));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
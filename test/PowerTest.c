@@ -0,0 +1,97 @@
+/*
+ Power Manager Test
+
+ Checks the idle loop's sleep mode choice, idle hook and counters.  Needs
+ the library and the test built with AVRX_POWER.
+
+ The following API covered:
+    AvrXSetIdleHook
+    AvrXPowerHold
+    AvrXPowerRelease
+    AvrXPowerReset
+    AvrXPowerStats
+
+ One task sleeps on a timer most of the time, so the system is idle with
+ a timer running and must only ever use AVRX_SLEEP_IDLE.  The idle hook
+ counts its runs.  Every REPORT rounds the task checks that the hook ran,
+ that idle was entered and charged ticks in that mode and in no other,
+ and prints "1".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define REPORT  20
+
+TimerControlBlock Sleep;
+
+volatile uint16_t HookRuns;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+void Hook(void)
+{
+    HookRuns++;
+}
+
+AVRX_TASKDEF(worker, 30, 1)
+{
+    uint8_t i, m;
+    uint16_t runs;
+
+    AvrXPowerHold(AVRX_SLEEP_ADC);      // Holds lighter than the tick
+    AvrXPowerHold(AVRX_SLEEP_PWR_DOWN); // limit change nothing
+    AvrXPowerRelease(AVRX_SLEEP_PWR_DOWN);
+
+    while(1)
+    {
+        AvrXPowerReset();
+        runs = HookRuns;
+        for (i = 0; i < REPORT; i++)
+            AvrXDelay(&Sleep, 5);
+
+        if (HookRuns == runs)
+            {debug_puts("HALT@hook");AvrXHalt();}
+        if (AvrXPowerStats.entries[AVRX_SLEEP_IDLE] < REPORT ||
+            AvrXPowerStats.ticks[AVRX_SLEEP_IDLE] == 0)
+            {debug_puts("HALT@idle");AvrXHalt();}
+        for (m = AVRX_SLEEP_IDLE + 1; m < AVRX_SLEEP_MODES; m++)
+            if (AvrXPowerStats.entries[m] || AvrXPowerStats.ticks[m])
+                {debug_puts("HALT@mode");AvrXHalt();}
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	TCNT0 = TCNT0_INIT;   // Initialize Timer Hardware
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXSetIdleHook(Hook);
+    AvrXRunTask(TCB(worker));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
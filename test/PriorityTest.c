@@ -0,0 +1,104 @@
+/*
+ Priority Change Test
+
+ Checks that a priority change re-sorts the run queue and switches at once.
+
+ The following API covered:
+    AvrXChangePriority
+    AvrXPriority
+
+ Run it with the library built both with and without AVRX_DLIST.
+
+ The boss never blocks, so the worker and the helper, both below it, stay
+ ready but never run on their own.  Each round the boss raises the worker
+ above itself, which must run before the call returns, and then lowers
+ itself below the helper, which must likewise run at once.  Both count
+ their runs and block again until the boss lets them go.  Each round
+ prints "1".
+
+ While the worker is blocked the boss also raises it further.  It must
+ stay on the semaphore and not run until the semaphore is set; with
+ AVRX_DLIST a blocked task was once pulled off its waiter list here.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+AVRX_MUTEX(Park);
+AVRX_MUTEX(Park2);
+
+volatile uint8_t Ran;
+volatile uint8_t Yielded;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_TASKDEF(worker, 10, 10)
+{
+    while(1)
+    {
+        Ran++;
+        AvrXWaitSemaphore(&Park);
+    }
+}
+
+AVRX_TASKDEF(helper, 10, 7)
+{
+    while(1)
+    {
+        Yielded++;
+        AvrXWaitSemaphore(&Park2);
+    }
+}
+
+AVRX_TASKDEF(boss, 20, 5)
+{
+    while(1)
+    {
+        Ran = 0;
+        if (AvrXChangePriority(PID(worker), 1) != 10)   // Above us
+            {debug_puts("HALT@prev");AvrXHalt();}
+        if (Ran != 1)
+            {debug_puts("HALT@raise");AvrXHalt();}
+
+        AvrXChangePriority(PID(worker), 0); // Blocked: no wakeup
+        if (Ran != 1 || Park != PID(worker))
+            {debug_puts("HALT@blocked");AvrXHalt();}
+
+        AvrXChangePriority(PID(worker), 10);
+        AvrXSetSemaphore(&Park);            // Ready again, below us
+        if (Ran != 1 || Park != AVRX_SEM_PEND)
+            {debug_puts("HALT@below");AvrXHalt();}
+
+        Yielded = 0;
+        AvrXChangePriority(PID(boss), 9);   // Below the helper
+        if (Yielded != 1 || AvrXPriority(PID(boss)) != 9)
+            {debug_puts("HALT@lower");AvrXHalt();}
+        AvrXChangePriority(PID(boss), 5);
+        AvrXSetSemaphore(&Park2);
+
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXRunTask(TCB(worker));
+    AvrXRunTask(TCB(helper));
+    AvrXRunTask(TCB(boss));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
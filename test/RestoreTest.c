@@ -0,0 +1,133 @@
+/*
+ Context Restore Test
+
+ Hammers the kernel exit with interrupts so that some of them land while
+ _Epilog is reloading a task's registers with interrupts enabled.
+
+ The following API covered:
+    AvrXEnterKernel
+    AvrXLeaveKernel
+    AvrXIntSetSemaphore
+    AvrXYield
+
+ Timer 2 overflows every 2048 cycles and wakes the high priority task on
+ every other overflow, so tasks are switched and resumed all the time.
+ Two tasks at the same priority keep many locals live while they run the
+ same sum two different ways; any register the kernel failed to put back
+ shows up as a mismatch.  They yield to each other after every pass, and
+ each prints "1" every REPORT passes.
+
+ Interrupts taken in the restore window stack below the saved context on
+ the task stack, which AVRX_TASK allows for with AVRX_RESTORE_STACK.  The
+ churn stacks are painted before the tasks start and each report checks
+ that the bottom of its stack is still untouched.
+ */
+
+#include <avr/interrupt.h>
+#include <string.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define REPORT  1000
+#define PAINT   0xA5
+
+AVRX_MUTEX(Kick);
+
+volatile uint8_t Phase;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_SIGINT(TIMER2_OVF_vect)
+{
+    AvrXEnterKernel();
+    if (++Phase & 1)
+        AvrXIntSetSemaphore(&Kick);
+    AvrXLeaveKernel();
+}
+
+/* Sums over i,j in 0..n-1 by brute force, checked against closed forms. */
+void Churn(uint8_t k, const uint8_t *stack, const char *where)
+{
+    uint16_t i, j, n, a, b, d;
+    uint16_t pass;
+
+    for (pass = 1; ; pass++)
+    {
+        n = 8 + (pass & 7);
+        a = b = d = 0;
+        for (i = 0; i < n; i++)
+            for (j = 0; j < n; j++)
+            {
+                a += i * k;
+                b += j;
+                d += (i ^ j) & 1;
+            }
+
+        if (a != k * n * (n * (n - 1) / 2) || b != n * (n * (n - 1) / 2))
+            {debug_puts(where);AvrXHalt();}
+        if (d != (n / 2) * (n - n / 2) * 2)
+            {debug_puts(where);AvrXHalt();}
+        if (pass % REPORT == 0)
+        {
+            if (stack[0] != PAINT)
+                {debug_puts(where);AvrXHalt();}
+            debug_puts("1");
+        }
+        AvrXYield();
+    }
+}
+
+AVRX_TASKDEF(kicked, 20, 1)
+{
+    while(1)
+        AvrXWaitSemaphore(&Kick);
+}
+
+AVRX_TASKDEF(churn1, 60, 2)
+{
+    Churn(3, churn1Stk, "HALT@churn1");
+}
+
+AVRX_TASKDEF(churn2, 60, 2)
+{
+    Churn(7, churn2Stk, "HALT@churn2");
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    memset(churn1Stk, PAINT, sizeof(churn1Stk));
+    memset(churn2Stk, PAINT, sizeof(churn2Stk));
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TCCR2 = _BV(CS21);    // Timer 2 overflows every 2048 cycles
+	TIMSK = _BV(TOIE0) | _BV(TOIE2);
+
+    AvrXRunTask(TCB(kicked));
+    AvrXRunTask(TCB(churn1));
+    AvrXRunTask(TCB(churn2));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
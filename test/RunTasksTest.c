@@ -0,0 +1,71 @@
+/*
+ Batch Start Test
+
+ Checks that tasks started together from a flash table run in priority
+ order, equal priorities in table order.
+
+ The following API covered:
+    AvrXRunTasks
+
+ Five tasks are listed out of priority order.  Each one records its
+ letter when it first runs and then waits forever, except the lowest
+ priority one, which checks the record and prints "1" if it reads
+ "ABCDE".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+AVRX_MUTEX(Never);
+
+char Order[6];
+uint8_t Count;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void Record(char ch)
+{
+    Order[Count++] = ch;
+    AvrXWaitSemaphore(&Never);
+}
+
+AVRX_TASKDEF(a, 10, 1) { Record('A'); while(1); }
+AVRX_TASKDEF(b, 10, 2) { Record('B'); while(1); }
+AVRX_TASKDEF(c, 10, 2) { Record('C'); while(1); }
+AVRX_TASKDEF(d, 10, 3) { Record('D'); while(1); }
+
+AVRX_TASKDEF(e, 20, 4)
+{
+    uint8_t i;
+
+    Order[Count++] = 'E';
+    for (i = 0; i < 5; i++)
+        if (Order[i] != "ABCDE"[i])
+            {debug_puts("HALT@order");AvrXHalt();}
+    debug_puts("1");
+    AvrXHalt();
+}
+
+TaskControlBlock * const Boot[] PROGMEM =
+    { TCB(d), TCB(b), TCB(e), TCB(a), TCB(c) };
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXRunTasks(Boot, sizeof(Boot) / sizeof(Boot[0]));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,111 @@
+/*
+ Scheduler Lock Test
+
+ Checks that a scheduler lock holds back task switches, but not
+ interrupts, and that critical sections nest.
+
+ The following API covered:
+    AvrXSchedLock
+    AvrXSchedUnlock
+    AvrXEnterCritical
+    AvrXLeaveCritical
+
+ A low priority task locks the scheduler twice and wakes a high priority
+ task.  The high priority task must not run until the outer unlock, and
+ must have run straight after it.  Meanwhile the timer interrupt must keep
+ ticking.  Nested critical sections must leave interrupts off until the
+ outer one ends.  Each pass prints "1".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+AVRX_MUTEX(Wake);
+
+volatile uint16_t Ticks;
+volatile uint8_t Ran;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    Ticks++;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_TASKDEF(urgent, 20, 1)
+{
+    while(1)
+    {
+        AvrXWaitSemaphore(&Wake);
+        Ran = 1;
+    }
+}
+
+AVRX_TASKDEF(locker, 40, 2)
+{
+    uint16_t t;
+    uint8_t s1, s2;
+
+    while(1)
+    {
+        Ran = 0;
+        AvrXSchedLock();
+        AvrXSchedLock();
+        AvrXSetSemaphore(&Wake);
+        AvrXSchedUnlock();
+        if (Ran)
+            {debug_puts("HALT@inner");AvrXHalt();}
+
+        t = Ticks;
+        while (Ticks == t)
+            ;                   // Interrupts still on
+        if (Ran)
+            {debug_puts("HALT@tick");AvrXHalt();}
+
+        AvrXSchedUnlock();
+        if (!Ran)
+            {debug_puts("HALT@outer");AvrXHalt();}
+
+        s1 = AvrXEnterCritical();
+        s2 = AvrXEnterCritical();
+        AvrXLeaveCritical(s2);
+        if (SREG & _BV(SREG_I))
+            {debug_puts("HALT@nest");AvrXHalt();}
+        AvrXLeaveCritical(s1);
+        if (!(SREG & _BV(SREG_I)))
+            {debug_puts("HALT@sreg");AvrXHalt();}
+
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(urgent));
+    AvrXRunTask(TCB(locker));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
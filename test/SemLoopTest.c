@@ -0,0 +1,101 @@
+/*
+ Semaphore Loop Test
+
+ Measures an uncontended lock/unlock loop with the inline fast paths and
+ with the out-of-line kernel calls.
+
+ The following API covered:
+    AvrXWaitSemaphore
+    AvrXSetSemaphore
+    AvrXTestSemaphore
+    AvrXResetSemaphore
+
+ Timer 1 runs at the CPU clock, with no other interrupts enabled.  The
+ task times LOOPS wait/set pairs on a free mutex written as ordinary
+ calls, which the header expands in place, then the same loop calling
+ the library functions directly (a name in brackets is not expanded).
+ It prints the cycles per pair for each, inline first, and checks the
+ inline loop is the faster and that test and reset behave as before.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define LOOPS   100
+
+AVRX_MUTEX(Lock);
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_TASKDEF(timer, 20, 1)
+{
+    uint16_t t, fast, slow;
+    uint8_t i;
+
+    while(1)
+    {
+        t = TCNT1;
+        for (i = 0; i < LOOPS; i++)
+        {
+            AvrXWaitSemaphore(&Lock);
+            AvrXSetSemaphore(&Lock);
+        }
+        fast = (TCNT1 - t) / LOOPS;
+
+        t = TCNT1;
+        for (i = 0; i < LOOPS; i++)
+        {
+            (AvrXWaitSemaphore)(&Lock);
+            (AvrXSetSemaphore)(&Lock);
+        }
+        slow = (TCNT1 - t) / LOOPS;
+
+        debug_puthex(fast);
+        debug_puts(" ");
+        debug_puthex(slow);
+        debug_puts("\n");
+        if (fast >= slow)
+            {debug_puts("HALT@speed");AvrXHalt();}
+
+        if (AvrXTestSemaphore(&Lock) != AVRX_SEM_DONE ||
+            AvrXTestSemaphore(&Lock) != AVRX_SEM_PEND)
+            {debug_puts("HALT@test");AvrXHalt();}
+        AvrXSetSemaphore(&Lock);
+        AvrXResetSemaphore(&Lock);
+        if (Lock != AVRX_SEM_PEND)
+            {debug_puts("HALT@reset");AvrXHalt();}
+        AvrXSetSemaphore(&Lock);
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	TCCR1B = _BV(CS10);   // Timer 1 counts CPU cycles
+
+    AvrXSetSemaphore(&Lock);
+    AvrXRunTask(TCB(timer));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,119 @@
+/*
+ Sequence Lock Test
+
+ Checks latest value sharing from an interrupt handler and from a task.
+
+ The following API covered:
+    AvrXIntSeqWrite
+    AvrXSeqWrite
+    AvrXSeqRead
+    AvrXSeqWait
+
+ The timer interrupt handler writes a sample and its complement each tick.
+ The waiter blocks for each new sample, checks that it is whole and newer
+ than the last, and passes it on through a second lock that it writes
+ itself.  The poller, at the lowest priority, reads both locks over and
+ over, so the tick often lands in the middle of its copy, and checks every
+ copy is whole.  Every REPORT samples the waiter prints "1".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define REPORT  100
+
+typedef struct
+{
+    uint16_t n;
+    uint16_t check;         /* ~n */
+}
+Sample;
+
+AVRX_SEQLOCK(SensorLock);
+Sample Sensor;
+
+AVRX_SEQLOCK(EchoLock);
+Sample Echo;
+
+Sample Next;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    Next.n++;
+    Next.check = ~Next.n;
+    AvrXIntSeqWrite(&SensorLock, &Sensor, &Next, sizeof(Sample));
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_TASKDEF(waiter, 30, 1)
+{
+    Sample s;
+    uint16_t last = 0;
+    uint8_t seq;
+
+    while(1)
+    {
+        seq = AvrXSeqRead(&SensorLock, &s, &Sensor, sizeof(Sample));
+        if (s.check != (uint16_t)~s.n)
+            {debug_puts("HALT@torn");AvrXHalt();}
+        if (s.n != last)
+        {
+            if ((int16_t)(s.n - last) < 0)
+                {debug_puts("HALT@order");AvrXHalt();}
+            last = s.n;
+            AvrXSeqWrite(&EchoLock, &Echo, &s, sizeof(Sample));
+            if (last % REPORT == 0)
+                debug_puts("1");
+        }
+        AvrXSeqWait(&SensorLock, seq);
+    }
+}
+
+AVRX_TASKDEF(poller, 30, 2)
+{
+    Sample s;
+
+    while(1)
+    {
+        AvrXSeqRead(&SensorLock, &s, &Sensor, sizeof(Sample));
+        if (s.check != (uint16_t)~s.n)
+            {debug_puts("HALT@poll");AvrXHalt();}
+        AvrXSeqRead(&EchoLock, &s, &Echo, sizeof(Sample));
+        if (s.check != (uint16_t)~s.n)
+            {debug_puts("HALT@echo");AvrXHalt();}
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    Sensor.check = Echo.check = ~0;
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(waiter));
+    AvrXRunTask(TCB(poller));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
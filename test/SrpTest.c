@@ -0,0 +1,190 @@
+/*
+ Stack Resource Policy Test
+
+ Checks the order in which SRP jobs run, nest and are held off by ceilings.
+
+ The following API covered:
+    AvrXSrpRegister
+    AvrXSrpPost
+    AvrXIntSrpPost
+    AvrXSrpDispatch
+    AvrXSrpLock
+    AvrXSrpUnlock
+
+ Each job adds a letter to Trace, which the boss checks after each step:
+
+    preempt  The low job (level 5) posts the high job (level 1), which
+             must run nested inside it before the post returns: "LHl".
+    ceiling  The low job locks the resource it shares with the high job
+             (ceiling 1) and posts the high job, which must wait for the
+             unlock, and then the urgent job (level 0), which is above
+             the ceiling and must run at once: "LU-Hl".
+    unlock   The boss itself holds the same ceiling while it posts the
+             high job, which must run in AvrXSrpUnlock: "H".
+    return   Every tick the interrupt handler posts the tick job (level 3)
+             over a spinning task.  After the job the spinner must carry
+             on with its registers intact.
+
+ Each round prints "1".
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define LOW     5
+#define TICKJOB 3
+#define HIGH    1
+#define URGENT  0
+
+#define SHARED  HIGH            // Ceiling of the resource of LOW and HIGH
+
+enum { PREEMPT, CEILING };
+
+TimerControlBlock Wait;
+
+char Trace[8];
+uint8_t Len;
+uint8_t Mode;
+
+volatile uint8_t TickJobs;
+volatile uint16_t Spins;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void Mark(char c)
+{
+    if (Len < sizeof(Trace))
+        Trace[Len++] = c;
+}
+
+void Expect(const char *s, const char *where)
+{
+    uint8_t i;
+
+    for (i = 0; i < Len && s[i] == Trace[i]; i++)
+        ;
+    if (i != Len || s[i] != 0)
+        {debug_puts("HALT@");debug_puts(where);AvrXHalt();}
+    Len = 0;
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXIntSrpPost(TICKJOB);
+    AvrXSrpDispatch();
+    AvrXLeaveKernel();
+}
+
+void LowJob(void)
+{
+    uint8_t c;
+
+    Mark('L');
+    if (Mode == PREEMPT)
+        AvrXSrpPost(HIGH);
+    else
+    {
+        c = AvrXSrpLock(SHARED);
+        AvrXSrpPost(HIGH);          // Held off by the ceiling
+        AvrXSrpPost(URGENT);        // Above it
+        Mark('-');
+        AvrXSrpUnlock(c);
+    }
+    Mark('l');
+}
+
+void TickJob(void)
+{
+    TickJobs++;
+}
+
+void HighJob(void)
+{
+    Mark('H');
+}
+
+void UrgentJob(void)
+{
+    Mark('U');
+}
+
+AVRX_TASKDEF(spinner, 20, 5)
+{
+    uint16_t a = 0, b = 0xFFFF;     // Live across every interrupt
+
+    while(1)
+    {
+        a++;
+        b--;
+        if ((uint16_t)(a + b) != 0xFFFF)
+            {debug_puts("HALT@frame");AvrXHalt();}
+        Spins++;
+    }
+}
+
+AVRX_TASKDEF(boss, 20, 1)
+{
+    uint8_t c, t;
+    uint16_t s;
+
+    while(1)
+    {
+        Mode = PREEMPT;
+        AvrXSrpPost(LOW);
+        Expect("LHl", "preempt");
+
+        Mode = CEILING;
+        AvrXSrpPost(LOW);
+        Expect("LU-Hl", "ceiling");
+
+        c = AvrXSrpLock(SHARED);
+        AvrXSrpPost(HIGH);
+        if (Len != 0)
+            {debug_puts("HALT@lock");AvrXHalt();}
+        AvrXSrpUnlock(c);
+        Expect("H", "unlock");
+
+        t = TickJobs;
+        s = Spins;
+        AvrXDelay(&Wait, 20);
+        if ((uint8_t)(TickJobs - t) < 19 || Spins == s)
+            {debug_puts("HALT@return");AvrXHalt();}
+
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXSrpRegister(LOW, LowJob);
+    AvrXSrpRegister(TICKJOB, TickJob);
+    AvrXSrpRegister(HIGH, HighJob);
+    AvrXSrpRegister(URGENT, UrgentJob);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);   // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(spinner));
+    AvrXRunTask(TCB(boss));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,180 @@
+/*
+ Statistics Test
+
+ Checks the figures recorded for a contended mutex and a message queue.
+ Needs the library built with AVRX_STATS.
+
+ The following API covered:
+    AvrXStatsMutex
+    AvrXStatsQueue
+    AvrXStatsFirst
+    AvrXStatsReset
+
+ Three workers of equal priority take turns at a mutex, yielding while they
+ hold it so the other two queue up behind.  A producer sends bursts of
+ BURST messages to a lower priority consumer, waiting for each burst to be
+ drained.  Once everything is idle the monitor checks and prints each
+ registered block (acquires, contended, max waiters, max depth), resets
+ them and releases everyone for another pass.
+ */
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define ROUNDS  10
+#define BURST   5
+
+AVRX_MUTEX(Bus);
+AVRX_MUTEX(Drained);
+AVRX_MUTEX(Go);
+AVRX_MESSAGEQ(RxQueue);
+
+MessageControlBlock Msg[BURST];
+AvrXStats BusStats, RxStats;
+
+volatile uint8_t Idle;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+void Worker(void)
+{
+    uint8_t i;
+
+    while(1)
+    {
+        for (i = 0; i < ROUNDS; i++)
+        {
+            AvrXWaitSemaphore(&Bus);
+            AvrXYield();
+            AvrXSetSemaphore(&Bus);
+        }
+        Idle++;
+        AvrXWaitSemaphore(&Go);
+    }
+}
+
+AVRX_TASKDEF(worker1, 20, 3)
+{
+    Worker();
+}
+
+AVRX_TASKDEF(worker2, 20, 3)
+{
+    Worker();
+}
+
+AVRX_TASKDEF(worker3, 20, 3)
+{
+    Worker();
+}
+
+AVRX_TASKDEF(producer, 20, 2)
+{
+    uint8_t i, j;
+
+    while(1)
+    {
+        for (i = 0; i < ROUNDS; i++)
+        {
+            for (j = 0; j < BURST; j++)
+                AvrXSendMessage(&RxQueue, &Msg[j]);
+            AvrXWaitSemaphore(&Drained);
+        }
+        Idle++;
+        AvrXWaitSemaphore(&Go);
+    }
+}
+
+AVRX_TASKDEF(consumer, 20, 4)
+{
+    uint8_t j;
+
+    while(1)
+    {
+        for (j = 0; j < BURST; j++)
+            AvrXWaitMessage(&RxQueue);
+        AvrXSetSemaphore(&Drained);
+    }
+}
+
+void Check(pAvrXStats p, uint16_t acquires, uint8_t maxwaiters, uint8_t maxdepth)
+{
+    debug_puthex(p->acquires);
+    debug_puts(" ");
+    debug_puthex(p->contended);
+    debug_puts(" ");
+    debug_puthex(p->maxwaiters);
+    debug_puts(" ");
+    debug_puthex(p->maxdepth);
+    debug_puts("\n");
+
+    if (p->acquires != acquires || p->contended == 0 ||
+        p->maxwaiters != maxwaiters || p->maxdepth != maxdepth)
+        {debug_puts("HALT@stats");AvrXHalt();}
+}
+
+AVRX_TASKDEF(monitor, 40, 5)
+{
+    pAvrXStats p;
+    uint8_t n;
+
+    while(1)
+    {
+        if (Idle != 4)      // Only runs once the others are all blocked
+            {debug_puts("HALT@idle");AvrXHalt();}
+
+        n = 0;
+        for (p = AvrXStatsFirst(); p; p = p->next)
+        {
+            if (p == &BusStats)
+                Check(p, 3 * ROUNDS, 2, 0);
+            else if (p == &RxStats)
+                Check(p, ROUNDS * BURST, 1, BURST);
+            else
+                {debug_puts("HALT@list");AvrXHalt();}
+            AvrXStatsReset(p);
+            n++;
+        }
+        if (n != 2)
+            {debug_puts("HALT@count");AvrXHalt();}
+
+        Idle = 0;
+        AvrXBroadcastSemaphore(&Go);
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXStatsMutex(&BusStats, &Bus);
+    AvrXStatsQueue(&RxStats, &RxQueue);
+    AvrXSetSemaphore(&Bus);
+
+    AvrXRunTask(TCB(worker1));
+    AvrXRunTask(TCB(worker2));
+    AvrXRunTask(TCB(worker3));
+    AvrXRunTask(TCB(producer));
+    AvrXRunTask(TCB(consumer));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
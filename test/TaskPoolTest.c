@@ -0,0 +1,92 @@
+/*
+ Task Pool Test
+
+ Exercises the task pool
+
+ The following API covered:
+    AvrXPoolInit
+    AvrXSpawn
+    AvrXJoin
+    AvrXPoolExit        // Indirectly covered by returning from a job
+    AvrXPoolKill
+
+ Two slots are shared by a stream of short jobs.  Each job doubles its
+ argument into a result array; the main task joins each job and checks
+ the result, checks that a third spawn fails while both slots are busy,
+ and kills a job that is blocked waiting for a semaphore.
+ */
+
+#include "avrx.h"
+#include "hardware.h"
+
+AVRX_TASKPOOL(Pool, 20, 2);
+
+AVRX_MUTEX(Never);
+
+volatile uint16_t Result[2];
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void Double(void *arg)
+{
+    uint16_t n = (uint16_t)arg;
+
+    Result[n & 1] = n * 2;
+}
+
+void Block(void *arg)
+{
+    AvrXWaitSemaphore(&Never);
+}
+
+AVRX_TASKDEF(task1, 40, 3)
+{
+    pPoolTask a, b;
+    uint16_t n = 0;
+
+    AvrXPoolInit(&Pool);
+
+    while(1)
+    {
+        a = AvrXSpawn(&Pool, Double, (void *)n, 4);      // Lower priority,
+        b = AvrXSpawn(&Pool, Double, (void *)(n + 1), 4);// run when we join
+        if (a == 0 || b == 0)
+            {debug_puts("HALT@spawn");AvrXHalt();}
+        if (AvrXSpawn(&Pool, Double, 0, 4) != 0)
+            {debug_puts("HALT@full");AvrXHalt();}
+
+        AvrXJoin(a);
+        AvrXJoin(b);
+        if (Result[n & 1] != n * 2 || Result[(n + 1) & 1] != (n + 1) * 2)
+            {debug_puts("HALT@result");AvrXHalt();}
+
+        a = AvrXSpawn(&Pool, Block, 0, 2);  // Higher priority, blocks at once
+        AvrXSuspend(&a->pid);   // Blocked and suspended: killable everywhere
+        AvrXSetSemaphore(&Never);
+        if (!AvrXPoolKill(a))
+            {debug_puts("HALT@kill");AvrXHalt();}
+        AvrXJoin(a);
+
+        n += 2;
+        debug_puts("1");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+    AvrXRunTask(&task1Tcb);
+
+    AvrXLeaveKernel();           // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,131 @@
+/*
+ Time Slice Test
+
+ Exercises time slicing among equal priority tasks.  The library and this
+ test must both be built with -DAVRX_TIMESLICE.
+
+ The following API covered:
+    AvrXSetTimeSlice
+    AvrXTimerHandler        // Charges the running task each tick
+    AvrXIntReschedule       // Indirectly covered
+
+ Three CPU-bound tasks at the same priority never yield.  Without time
+ slicing only the first would ever run.  Every REPORT ticks a higher
+ priority task prints which workers made progress ("123" when all three
+ shared the CPU) followed by the total work done, as a measure of the
+ throughput lost to the extra context switches.
+
+ Build with -DQUANTUM=n to compare quanta, e.g.
+
+    make TimeSliceTest.elf CFLAGS="... -DAVRX_TIMESLICE -DQUANTUM=1"
+
+ Smaller quanta give finer interleaving (fairness) at the cost of more
+ task switches per second (throughput).
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#ifndef QUANTUM
+#define QUANTUM 4
+#endif
+
+#define REPORT  100
+
+TimerControlBlock ReportTimer;
+
+volatile uint16_t Work[3];
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+AVRX_TASKDEF(worker1, 10, 3)
+{
+    while(1)
+        Work[0]++;
+}
+
+AVRX_TASKDEF(worker2, 10, 3)
+{
+    while(1)
+        Work[1]++;
+}
+
+AVRX_TASKDEF(worker3, 10, 3)
+{
+    while(1)
+        Work[2]++;
+}
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    uint16_t last[3] = { 0, 0, 0 };
+    uint16_t total;
+    uint8_t i;
+
+    AvrXSetTimeSlice(PID(worker1), QUANTUM);
+    AvrXSetTimeSlice(PID(worker2), QUANTUM);
+    AvrXSetTimeSlice(PID(worker3), QUANTUM);
+
+    while(1)
+    {
+        AvrXDelay(&ReportTimer, REPORT);
+
+        total = 0;
+        for (i = 0; i < 3; i++)
+        {
+            uint16_t w = Work[i];
+            if (w != last[i])
+                special_output_port = '1' + i;
+            total += w - last[i];
+            last[i] = w;
+        }
+        debug_puts(" ");
+        debug_puthex(total);
+        debug_puts("\n");
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(worker1));
+    AvrXRunTask(TCB(worker2));
+    AvrXRunTask(TCB(worker3));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,146 @@
+/*
+ Timer Batch Test
+
+ Measures the cost of a timer tick against the number of timers that
+ expire on it.
+
+ The following API covered:
+    AvrXTimerHandler        // Batched wake-up of coincident timers
+    AvrXDelay
+
+ Up to NTASKS sleepers, each at its own priority, sleep until the next
+ multiple of PERIOD ticks so their timers always expire together.  Timer 1 runs at the CPU
+ clock and the timer interrupt records the longest AvrXTimerHandler() call.
+ Every REPORT ticks the monitor prints the number of sleepers running and
+ that worst case in cycles, then starts one more sleeper.  The sleepers
+ also check they were woken on time.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define NTASKS  8
+#define PERIOD  10
+#define REPORT  100
+
+TimerControlBlock Timer[NTASKS], ReportTimer;
+
+volatile uint16_t Ticks;
+volatile uint16_t TickCost;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    uint16_t t;
+
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    Ticks++;
+    t = TCNT1;
+    AvrXTimerHandler();
+    t = TCNT1 - t;
+    if (t > TickCost)
+        TickCost = t;
+    AvrXLeaveKernel();
+}
+
+uint16_t Now(void)
+{
+    uint16_t t;
+
+    BeginCritical();
+    t = Ticks;
+    EndCritical();
+    return t;
+}
+
+void Sleeper(uint8_t n)
+{
+    uint16_t t, d;
+
+    while(1)
+    {
+        t = Now();
+        d = PERIOD - t % PERIOD;
+        AvrXDelay(&Timer[n], d);
+        if ((uint16_t)(Now() - t) < d)
+            {debug_puts("HALT@early");AvrXHalt();}
+    }
+}
+
+#define SLEEPER(n) \
+AVRX_TASKDEF(sleeper##n, 20, 2 + n) \
+{ \
+    Sleeper(n); \
+}
+
+SLEEPER(0)
+SLEEPER(1)
+SLEEPER(2)
+SLEEPER(3)
+SLEEPER(4)
+SLEEPER(5)
+SLEEPER(6)
+SLEEPER(7)
+
+TaskControlBlock *const Sleepers[NTASKS] =
+{
+    TCB(sleeper0), TCB(sleeper1), TCB(sleeper2), TCB(sleeper3),
+    TCB(sleeper4), TCB(sleeper5), TCB(sleeper6), TCB(sleeper7)
+};
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    uint8_t n;
+
+    for (n = 0; n <= NTASKS; n++)
+    {
+        TickCost = 0;
+        AvrXDelay(&ReportTimer, REPORT);
+
+        debug_puthex(n);
+        debug_puts(" ");
+        debug_puthex(TickCost);
+        debug_puts("\n");
+
+        if (n < NTASKS)
+            AvrXRunTask(Sleepers[n]);
+    }
+    AvrXHalt();
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TCCR1B = _BV(CS10);   // Timer 1 counts CPU cycles
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,139 @@
+/*
+ Timer Slack Test
+
+ Counts wake-ups with and without timer slack.
+
+ The following API covered:
+    AvrXDelaySlack
+    AvrXStartTimerSlack     // Indirectly covered
+
+ Four sleepers wake on unrelated periods.  Each notes the tick it woke on,
+ and every REPORT ticks the monitor prints the slack in use and the number
+ of distinct ticks on which any sleeper woke, then alternates between no
+ slack and SLACK ticks.  With slack the count should be clearly lower.
+ The sleepers check they never wake early, or more than the slack late.
+ */
+
+#include <avr/interrupt.h>
+
+#include "avrx.h"
+#include "hardware.h"
+
+#define NTASKS  4
+#define SLACK   4
+#define REPORT  1000
+
+static const uint16_t Period[NTASKS] = { 7, 9, 10, 12 };
+
+TimerControlBlock Timer[NTASKS], ReportTimer;
+
+volatile uint16_t Ticks;
+volatile uint16_t LastWake;
+volatile uint16_t Wakes;
+volatile uint16_t Slack;
+
+/* This port corresponds to the "-W 0x20,-" command line option. */
+#define special_output_port (*((volatile char *)0x20))
+
+/* Poll the specified string out the debug port. */
+void debug_puts(const char *str) {
+  const char *c;
+
+  for(c = str; *c; c++)
+    special_output_port = *c;
+}
+
+void debug_puthex(uint16_t w) {
+  static const char hex[] = "0123456789ABCDEF";
+  int8_t i;
+
+  for (i = 12; i >= 0; i -= 4)
+    special_output_port = hex[(w >> i) & 0xF];
+}
+
+AVRX_SIGINT(TIMER0_OVF_vect)
+{
+    AvrXEnterKernel();
+    TCNT0 = TCNT0_INIT;
+    Ticks++;
+    AvrXTimerHandler();
+    AvrXLeaveKernel();
+}
+
+uint16_t Now(void)
+{
+    uint16_t t;
+
+    BeginCritical();
+    t = Ticks;
+    EndCritical();
+    return t;
+}
+
+void Sleeper(uint8_t n)
+{
+    uint16_t t, d, s;
+
+    while(1)
+    {
+        s = Slack;
+        t = Now();
+        AvrXDelaySlack(&Timer[n], Period[n], s);
+        d = Now() - t;
+        if (d < Period[n] || d > Period[n] + s + 1)
+            {debug_puts("HALT@wake");AvrXHalt();}
+
+        BeginCritical();
+        if (Ticks != LastWake)
+        {
+            LastWake = Ticks;
+            Wakes++;
+        }
+        EndCritical();
+    }
+}
+
+#define SLEEPER(n) \
+AVRX_TASKDEF(sleeper##n, 20, 2 + n) \
+{ \
+    Sleeper(n); \
+}
+
+SLEEPER(0)
+SLEEPER(1)
+SLEEPER(2)
+SLEEPER(3)
+
+AVRX_TASKDEF(monitor, 40, 1)
+{
+    while(1)
+    {
+        Wakes = 0;
+        AvrXDelay(&ReportTimer, REPORT);
+
+        debug_puthex(Slack);
+        debug_puts(" ");
+        debug_puthex(Wakes);
+        debug_puts("\n");
+        Slack = Slack ? 0 : SLACK;
+    }
+}
+
+int main(void)
+{
+    AvrXSetKernelStack(0);
+
+	MCUCR = _BV(SE);      // Initialize Timer Hardware
+	TCNT0 = TCNT0_INIT;
+	TCCR0 = TMC8_CK256;
+	TIMSK = _BV(TOIE0);    // Enable Timer overflow interrupt
+
+    AvrXRunTask(TCB(sleeper0));
+    AvrXRunTask(TCB(sleeper1));
+    AvrXRunTask(TCB(sleeper2));
+    AvrXRunTask(TCB(sleeper3));
+    AvrXRunTask(TCB(monitor));
+
+    AvrXLeaveKernel();     // Switch from AvrX Stack to first task
+    while(1);
+}
@@ -0,0 +1,209 @@
+/*
+ 	avrx_eecache.c - Write-back EEPROM cache
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avrx.h"
+#include "avrxeeprom.h"
+#include "avrxeecache.h"
+
+/*****************************************************************************/
+static uint8_t InWindow(pEECache pCache, const void *p, uint8_t sz)
+{
+	uint16_t off = (uint16_t)p - (uint16_t)pCache->base;
+
+	return (uint16_t)p >= (uint16_t)pCache->base && off + sz <= pCache->size;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Marks the line(s) covering 'sz' bytes at offset 'off' dirty.  Called
+	with interrupts disabled.  Returns non-zero if a clean line became
+	dirty so the caller can wake the flush task.
+**/
+static uint8_t MarkDirty(pEECache pCache, uint16_t off, uint8_t sz)
+{
+	uint8_t woke = 0;
+	uint16_t line, last;
+
+	line = off / pCache->linesz;
+	last = (off + sz - 1) / pCache->linesz;
+
+	for (; line <= last; line++)
+	{
+		uint8_t bit = _BV(line & 7);
+
+		if (!(pCache->dirty[line >> 3] & bit))
+		{
+			pCache->dirty[line >> 3] |= bit;
+			woke = 1;
+		}
+	}
+	return woke;
+}
+
+/*****************************************************************************/
+void AvrXEECacheInit(pEECache pCache)
+{
+	uint16_t i;
+
+	for (i = 0; i < pCache->size; i++)
+		pCache->ram[i] = AvrXReadEEProm(pCache->base + i);
+
+	for (i = 0; i < (AVRX_EECACHE_LINES(pCache->size, pCache->linesz) + 7) / 8; i++)
+		pCache->dirty[i] = 0;
+
+	AvrXResetSemaphore(&pCache->dirtysem);
+	AvrXSetSemaphore(&pCache->flushlock);
+}
+
+/*****************************************************************************/
+uint8_t AvrXEECacheRead(pEECache pCache, const uint8_t *p)
+{
+	if (InWindow(pCache, p, 1))
+		return pCache->ram[(uint16_t)p - (uint16_t)pCache->base];
+
+	return AvrXReadEEProm(p);
+}
+
+/*****************************************************************************/
+uint16_t AvrXEECacheReadWord(pEECache pCache, const uint16_t *p)
+{
+	uint16_t w;
+
+	if (InWindow(pCache, p, 2))
+	{
+		uint8_t *q = &pCache->ram[(uint16_t)p - (uint16_t)pCache->base];
+		uint8_t sreg = SREG;
+		cli();
+		w = q[0] | (q[1] << 8);
+		SREG = sreg;
+		return w;
+	}
+
+	return AvrXReadEEPromWord(p);
+}
+
+/*****************************************************************************/
+void AvrXEECacheWrite(pEECache pCache, uint8_t *p, uint8_t b)
+{
+	uint16_t off;
+	uint8_t woke;
+
+	if (!InWindow(pCache, p, 1))
+	{
+		AvrXWriteEEProm(p, b);
+		return;
+	}
+
+	off = (uint16_t)p - (uint16_t)pCache->base;
+
+	BeginCritical();
+	pCache->ram[off] = b;
+	woke = MarkDirty(pCache, off, 1);
+	EndCritical();
+
+	if (woke)
+		AvrXSetSemaphore(&pCache->dirtysem);
+}
+
+/*****************************************************************************/
+void AvrXEECacheWriteWord(pEECache pCache, uint16_t *p, uint16_t w)
+{
+	uint16_t off;
+	uint8_t woke;
+
+	if (!InWindow(pCache, p, 2))
+	{
+		AvrXWriteEEProm((uint8_t *)p,     w & 0xFF);
+		AvrXWriteEEProm((uint8_t *)p + 1, w >> 8);
+		return;
+	}
+
+	off = (uint16_t)p - (uint16_t)pCache->base;
+
+	BeginCritical();
+	pCache->ram[off]     = w & 0xFF;
+	pCache->ram[off + 1] = w >> 8;
+	woke = MarkDirty(pCache, off, 2);
+	EndCritical();
+
+	if (woke)
+		AvrXSetSemaphore(&pCache->dirtysem);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Each line's dirty bit is cleared before its bytes are copied out, so a
+	write that lands while the line is being flushed marks it dirty again
+	and it is picked up by the next flush rather than lost.
+
+	A cleared bit therefore does not mean the line is in EEPROM yet, only
+	that some flush has taken it.  Flushes hold flushlock throughout, so
+	one that finds a line clean knows any earlier flush of it is finished.
+**/
+void AvrXEECacheFlush(pEECache pCache)
+{
+	uint16_t line, nlines, off, end;
+	uint8_t bit, b;
+
+	nlines = AVRX_EECACHE_LINES(pCache->size, pCache->linesz);
+
+	AvrXWaitSemaphore(&pCache->flushlock);
+	for (line = 0; line < nlines; line++)
+	{
+		bit = _BV(line & 7);
+
+		BeginCritical();
+		if (!(pCache->dirty[line >> 3] & bit))
+		{
+			EndCritical();
+			continue;
+		}
+		pCache->dirty[line >> 3] &= ~bit;
+		EndCritical();
+
+		off = line * pCache->linesz;
+		end = off + pCache->linesz;
+		if (end > pCache->size)
+			end = pCache->size;
+
+		for (; off < end; off++)
+		{
+			b = pCache->ram[off];
+			if (AvrXReadEEProm(pCache->base + off) != b)
+				AvrXWriteEEProm(pCache->base + off, b);
+		}
+	}
+	AvrXSetSemaphore(&pCache->flushlock);
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
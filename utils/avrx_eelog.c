@@ -0,0 +1,208 @@
+/*
+ 	avrx_eelog.c - Wear-levelled EEPROM record log
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include "avrx.h"
+#include "avrxeeprom.h"
+#include "avrxeelog.h"
+
+#define SLOT_KEY	0
+#define SLOT_SEQ	1
+#define SLOT_LEN	2
+#define SLOT_DATA	3
+
+#define FREE_KEY	0xFF
+
+/*****************************************************************************/
+static uint8_t *SlotAddr(pEELog pLog, uint8_t slot)
+{
+	return pLog->base + (uint16_t)slot * (pLog->datasz + AVRX_EELOG_HDRSZ);
+}
+
+/*****************************************************************************/
+static uint8_t NextSlot(pEELog pLog, uint8_t slot)
+{
+	return ++slot == pLog->nslots ? 0 : slot;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Only write bytes that differ from what is already there.  Refreshing
+	a slot, or rewriting a record with the same value, then costs no
+	EEPROM write cycles at all.
+**/
+static void UpdateByte(uint8_t *p, uint8_t b)
+{
+	if (AvrXReadEEProm(p) != b)
+		AvrXWriteEEProm(p, b);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Two passes over the ring.  The first finds the write position: the
+	first free slot, or the first slot whose sequence number does not
+	follow on from its predecessor.  The second walks the ring from the
+	oldest slot (the write position) to the newest, so later records for
+	a key replace earlier ones in the index.
+
+	A slot whose write was interrupted is left with a free key, so it is
+	found as the write position and reused.
+**/
+void AvrXEELogInit(pEELog pLog)
+{
+	uint8_t slot, key, seq, prev, head;
+	uint8_t *p;
+
+	for (key = 0; key < pLog->nkeys; key++)
+		pLog->index[key] = AVRX_EELOG_NOSLOT;
+
+	head = 0;
+	prev = 0;
+	for (slot = 0; slot < pLog->nslots; slot++)
+	{
+		p   = SlotAddr(pLog, slot);
+		key = AvrXReadEEProm(p + SLOT_KEY);
+		seq = AvrXReadEEProm(p + SLOT_SEQ);
+
+		if (key == FREE_KEY || (slot != 0 && seq != (uint8_t)(prev + 1)))
+		{
+			head = slot;
+			break;
+		}
+		prev = seq;
+	}
+
+	pLog->head = head;
+	pLog->seq  = 0;
+
+	slot = head;
+	do
+	{
+		p   = SlotAddr(pLog, slot);
+		key = AvrXReadEEProm(p + SLOT_KEY);
+
+		if (key < pLog->nkeys)
+		{
+			pLog->seq = AvrXReadEEProm(p + SLOT_SEQ) + 1;
+
+			if (AvrXReadEEProm(p + SLOT_LEN) != 0)
+				pLog->index[key] = slot;
+			else
+				pLog->index[key] = AVRX_EELOG_NOSLOT;
+		}
+		slot = NextSlot(pLog, slot);
+	}
+	while (slot != head);
+
+	AvrXSetSemaphore(&pLog->mutex);
+}
+
+/*****************************************************************************/
+uint8_t AvrXEELogRead(pEELog pLog, uint8_t key, void *buf, uint8_t sz)
+{
+	uint8_t slot, len, i;
+	uint8_t *p;
+
+	if (key >= pLog->nkeys)
+		return 0;
+
+	AvrXWaitSemaphore(&pLog->mutex);
+
+	len  = 0;
+	slot = pLog->index[key];
+	if (slot != AVRX_EELOG_NOSLOT)
+	{
+		p   = SlotAddr(pLog, slot);
+		len = AvrXReadEEProm(p + SLOT_LEN);
+		if (len > sz)
+			len = sz;
+		for (i = 0; i < len; i++)
+			((uint8_t *)buf)[i] = AvrXReadEEProm(p + SLOT_DATA + i);
+	}
+
+	AvrXSetSemaphore(&pLog->mutex);
+
+	return len;
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	Lazy compaction: any slot at the write position that still holds the
+	latest record for a key, this one included, is kept by giving it the
+	next sequence number in place.  Because there are more slots than keys
+	this always terminates at a slot that can be reused.
+
+	The new record is written key-last, with the key first marked free,
+	so a reset part way through leaves a free slot rather than a record
+	with torn data.  The slot never holds the key's current record, so
+	that record survives until the new one is complete.
+**/
+uint8_t AvrXEELogWrite(pEELog pLog, uint8_t key, const void *buf, uint8_t len)
+{
+	uint8_t slot, old, i;
+	uint8_t *p;
+
+	if (key >= pLog->nkeys || len > pLog->datasz)
+		return 0;
+
+	AvrXWaitSemaphore(&pLog->mutex);
+
+	slot = pLog->head;
+	for (;;)
+	{
+		p   = SlotAddr(pLog, slot);
+		old = AvrXReadEEProm(p + SLOT_KEY);
+
+		if (old >= pLog->nkeys || pLog->index[old] != slot)
+			break;
+
+		UpdateByte(p + SLOT_SEQ, pLog->seq++);
+		slot = NextSlot(pLog, slot);
+	}
+
+	if (old != FREE_KEY)
+		AvrXWriteEEProm(p + SLOT_KEY, FREE_KEY);
+
+	UpdateByte(p + SLOT_SEQ, pLog->seq++);
+	UpdateByte(p + SLOT_LEN, len);
+	for (i = 0; i < len; i++)
+		UpdateByte(p + SLOT_DATA + i, ((const uint8_t *)buf)[i]);
+	AvrXWriteEEProm(p + SLOT_KEY, key);
+
+	pLog->index[key] = len ? slot : AVRX_EELOG_NOSLOT;
+	pLog->head       = NextSlot(pLog, slot);
+
+	AvrXSetSemaphore(&pLog->mutex);
+
+	return len;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/
@@ -0,0 +1,86 @@
+/*
+ 	avrx_workq.c - Worker task job queues
+
+	Copyright (c)2023        Neil Johnson (neil@njohnson.co.uk)
+
+	This library is free software; you can redistribute it and/or
+	modify it under the terms of the GNU Library General Public
+	License as published by the Free Software Foundation; either
+	version 2 of the License, or (at your option) any later version.
+
+	This library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	Library General Public License for more details.
+
+	You should have received a copy of the GNU Library General Public
+	License along with this library; if not, write to the
+	Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+	Boston, MA  02111-1307, USA.
+
+	http://www.gnu.org/copyleft/lgpl.html
+
+*/
+
+#include "avrx.h"
+#include "avrxworkq.h"
+
+/*****************************************************************************/
+static void PrepareJob(pWorkJob job, AvrXJobFunc func, void *arg)
+{
+	job->func = func;
+	job->arg  = arg;
+	job->mcb.SObj.semaphore = AVRX_SEM_PEND;
+}
+
+/*****************************************************************************/
+void AvrXSubmitJob(pWorkQueue q, uint8_t lane, pWorkJob job, AvrXJobFunc func, void *arg)
+{
+	PrepareJob(job, func, arg);
+	AvrXSendMessage(&q->lanes[lane], &job->mcb);
+	AvrXSetSemaphore(&q->ready);
+}
+
+/*****************************************************************************/
+void AvrXIntSubmitJob(pWorkQueue q, uint8_t lane, pWorkJob job, AvrXJobFunc func, void *arg)
+{
+	PrepareJob(job, func, arg);
+	AvrXIntSendMessage(&q->lanes[lane], &job->mcb);
+	AvrXIntSetSemaphore(&q->ready);
+}
+
+/*****************************************************************************/
+/**
+	Notes
+
+	The ready semaphore is not a counting semaphore, so a worker always
+	drains the lanes before waiting on it.  A job submitted between the
+	last empty check and the wait leaves the semaphore _DONE, so the wait
+	returns at once and the job is not missed.  Each submit wakes at most
+	one idle worker.
+**/
+void AvrXWorkerRun(pWorkQueue q)
+{
+	pWorkJob job;
+	uint8_t lane;
+
+	while (1)
+	{
+		job = 0;
+		for (lane = 0; lane < q->nlanes && job == 0; lane++)
+			job = (pWorkJob)AvrXRecvMessage(&q->lanes[lane]);
+
+		if (job == 0)
+		{
+			AvrXWaitSemaphore(&q->ready);
+			continue;
+		}
+
+		job->func(job->arg);
+		AvrXAckMessage(&job->mcb);
+	}
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+/*****************************************************************************/